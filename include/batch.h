@@ -0,0 +1,70 @@
+/**
+ * @file batch.h
+ * @brief Batch decoding of many images in one process
+ *
+ * Decodes a list of images on a work-stealing thread pool, with one
+ * LineVisionContext per worker, and prints one tab-separated result line
+ * per image:
+ *
+ *   <path> TAB <status> TAB <digits> TAB <row> TAB <milliseconds>
+ *
+ * where status is one of `ok`, `recovered` (decoded with one digit filled
+ * in from the check digit), `checksum`, `decode`, `format`, `input`,
+ * `memory` or `load` (image could not be opened), digits is `-` when
+ * nothing was decoded and row is -1 when no row decoded. Lines are printed
+ * as images complete, so their order may differ from the input order.
+ *
+ * A throughput summary (images/s, p50 and p99 latency) is printed to
+ * standard error once every image is done.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @struct BatchPaths
+ * @brief Growable list of image paths
+ */
+typedef struct {
+    /** @brief Dynamically allocated paths */
+    char** paths;
+    /** @brief Number of paths */
+    size_t count;
+    /** @brief Number of allocated path slots */
+    size_t capacity;
+} BatchPaths;
+
+/**
+ * @brief Adds the images designated by a command line argument
+ *
+ * - `-` reads one path per line from standard input,
+ * - a directory adds its regular files (not recursive), sorted by name,
+ * - anything else is added as an image path.
+ *
+ * @param paths List to extend
+ * @param arg Command line argument
+ *
+ * @return 0 on success, -1 on memory allocation failure or if a directory
+ *         cannot be read
+ */
+int add_batch_paths(BatchPaths* paths, const char* arg);
+
+/**
+ * @brief Frees the paths of a list
+ *
+ * @param paths List to clear (the structure itself is not freed)
+ */
+void clear_batch_paths(BatchPaths* paths);
+
+/**
+ * @brief Decodes every image of a list
+ *
+ * @param paths Images to decode
+ * @param n_workers Number of worker threads (at least 1)
+ * @param out Stream receiving the result lines
+ *
+ * @return Number of images not decoded with a valid checksum, or -1 if the
+ *         thread pool or the contexts cannot be allocated
+ */
+int run_batch(const BatchPaths* paths, size_t n_workers, FILE* out);
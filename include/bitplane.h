@@ -0,0 +1,149 @@
+/**
+ * @file bitplane.h
+ * @brief Packed 1-bit binarized images
+ *
+ * A BitPlane holds the result of thresholding a grayscale image with one
+ * bit per pixel, leaving the grayscale data untouched for later retries.
+ * Each row starts on a 64-bit word boundary, so rows can be processed a
+ * word (64 pixels) at a time.
+ *
+ * Bit convention follows SegmentEAN: 1 = black (bar), 0 = white (space).
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "image.h"
+
+/**
+ * @struct BitPlane
+ * @brief Binarized image stored as 1 bit per pixel
+ */
+typedef struct {
+    /** @brief Width in pixels */
+    int width;
+    /** @brief Height in pixels */
+    int height;
+    /** @brief Number of 64-bit words per row */
+    size_t stride;
+    /** @brief Pixel x of row y is bit x % 64 of bits[y * stride + x / 64];
+     *  two zeroed padding words follow the last row */
+    uint64_t* bits;
+} BitPlane;
+
+/**
+ * @brief Allocates a bit plane
+ *
+ * @param width Width in pixels
+ * @param height Height in pixels
+ *
+ * @return Pointer to a dynamically allocated BitPlane, or NULL on invalid
+ *         size or memory allocation failure
+ *
+ * @note Allocated memory must be freed with destroy_bitplane()
+ */
+BitPlane* create_bitplane(int width, int height);
+
+/**
+ * @brief Allocates a bit plane from a context
+ *
+ * @param context Context providing the memory
+ * @param width Width in pixels
+ * @param height Height in pixels
+ *
+ * @return Pointer to a BitPlane living in the context, or NULL on invalid
+ *         size or allocation failure
+ *
+ * @note Must not be passed to destroy_bitplane(); the memory is released
+ *       by reset_linevision_context()
+ */
+BitPlane* create_bitplane_ctx(LineVisionContext* context, int width, int height);
+
+/**
+ * @brief Frees the memory allocated for a bit plane
+ *
+ * @param plane Pointer to the bit plane to destroy
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_bitplane(BitPlane* plane);
+
+/**
+ * @brief Binarizes a grayscale image into a bit plane
+ *
+ * Non-destructive counterpart of binarization(): pixels with values less
+ * than or equal to the threshold become 1 (black), the others 0. The
+ * image is not modified.
+ *
+ * @param image Grayscale image (single channel)
+ * @param threshold Threshold value (0-255), e.g. from otsu_threshold()
+ * @param plane Destination with the same size as the image
+ *
+ * @return `true` on success, `false` on NULL pointers, a non-grayscale
+ *         image or a size mismatch
+ */
+bool binarize_bitplane(const Image* image, int threshold, BitPlane* plane);
+
+/**
+ * @brief Binarizes a grayscale image into a bit plane with the selected method
+ *
+ * Non-destructive counterpart of binarization_with_options().
+ *
+ * For BINARIZATION_ADAPTIVE (Bradley), a pixel is black when
+ * `pixel * area * 100 <= window_sum * (100 - sensitivity)`, the window
+ * being clipped at the image borders. The window sum is read from
+ * running per-column sums over the rows of the window and a prefix sum of
+ * those columns, so the cost per pixel does not depend on the window
+ * size and the scratch memory is O(width).
+ *
+ * @param image Grayscale image (single channel)
+ * @param options Binarization options, or NULL for the defaults
+ * @param plane Destination with the same size as the image
+ *
+ * @return `true` on success, `false` on NULL pointers, a non-grayscale
+ *         image, a size mismatch or memory allocation failure
+ */
+bool binarize_bitplane_with_options(const Image* image, const BinarizationOptions* options, BitPlane* plane);
+
+/**
+ * @brief binarize_bitplane_with_options() with its scratch memory taken
+ *        from a context
+ *
+ * @param context Context providing the scratch memory (rewound before
+ *                returning)
+ * @param image Grayscale image (single channel)
+ * @param options Binarization options, or NULL for the defaults
+ * @param plane Destination with the same size as the image
+ *
+ * @return `true` on success, `false` on NULL pointers, a non-grayscale
+ *         image, a size mismatch or allocation failure
+ */
+bool binarize_bitplane_with_options_ctx(LineVisionContext* context, const Image* image, const BinarizationOptions* options, BitPlane* plane);
+
+/**
+ * @brief Returns the packed bits of a row
+ *
+ * @param plane Bit plane
+ * @param y Row index
+ *
+ * @return Pointer to the `stride` words of the row
+ */
+static inline const uint64_t* bitplane_row(const BitPlane* plane, int y) {
+    return &plane->bits[(size_t)y * plane->stride];
+}
+
+/**
+ * @brief Returns a single pixel of a bit plane
+ *
+ * @param plane Bit plane
+ * @param x Column index
+ * @param y Row index
+ *
+ * @return `true` for a black pixel
+ */
+static inline bool bitplane_get(const BitPlane* plane, int x, int y) {
+    return (bitplane_row(plane, y)[x >> 6] >> (x & 63)) & 1;
+}
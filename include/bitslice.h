@@ -0,0 +1,90 @@
+/**
+ * @file bitslice.h
+ * @brief Bit-sliced EAN-8 decoding of 64 rows at once
+ *
+ * A band of 64 consecutive rows of a BitPlane is transposed so that each
+ * pixel column becomes one 64-bit word, bit k holding row k of the band.
+ * Testing a module against a bar or a space is then a single AND (or
+ * AND-NOT) for the 64 rows, so guard checks and digit matching (the
+ * bitwise equivalents of is_valid_structure() and decode_code_ean8())
+ * are evaluated for the whole band in the time a scalar decoder spends on
+ * one row.
+ *
+ * All rows of a band are sampled at the same columns, which suits the
+ * upright barcodes crossing many consecutive rows that tall images hold.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitplane.h"
+#include "context.h"
+#include "ean_errors.h"
+#include "ean_patterns.h"
+
+/** @brief Number of rows decoded together */
+#define BITSLICE_ROWS 64
+
+/**
+ * @brief Transposes a 64x64 bit matrix in place
+ *
+ * Bit c of `block[r]` moves to bit r of `block[c]`, by swapping the
+ * off-diagonal blocks of halving size (6 passes of 32 word pairs).
+ *
+ * @param block Matrix, one row per word
+ */
+void transpose_bits_64x64(uint64_t block[64]);
+
+/**
+ * @brief Transposes a band of rows of a bit plane into column words
+ *
+ * @param plane Bit plane
+ * @param y0 First row of the band; rows past the plane read as white
+ * @param columns Output of `plane->stride * 64` words: bit k of
+ *        `columns[x]` is the pixel (x, y0 + k)
+ */
+void transpose_bitplane_band(const BitPlane* plane, int y0, uint64_t* columns);
+
+/**
+ * @brief Decodes EAN-8 barcodes from transposed columns
+ *
+ * Every start column is tried; for each, the 67 modules are sampled at
+ * their centers using the fixed-point module width, and the guards then
+ * the digits are matched for the 64 rows with bitwise operations. Check
+ * digits are computed only for the rows that fully decoded.
+ *
+ * @param[in]  columns Column words from transpose_bitplane_band()
+ * @param[in]  width   Number of columns
+ * @param[in]  rows    Mask of the rows that belong to the image
+ * @param[in]  module  Module width with MODULE_FIXED_SHIFT fractional bits
+ * @param[out] result  Caller-owned result; `status` is always set
+ * @param[out] pmatch  Rows that decoded to the digits of `result` (may be
+ *                     NULL)
+ *
+ * @return EAN8_ERROR_NONE with the digits of the first row that decoded
+ *         with a valid check digit, otherwise the furthest failure
+ *         (EAN8_ERROR_INVALID_CHECKSUM, EAN8_ERROR_INVALID_DECODE or
+ *         EAN8_ERROR_INVALID_FORMAT)
+ */
+EAN8Error decode_columns_ean8(const uint64_t* columns, size_t width, uint64_t rows, uint32_t module, EAN8Result* result, uint64_t* pmatch);
+
+/**
+ * @brief Decodes a band of 64 rows of a bit plane
+ *
+ * Estimates the module width from a few probe rows of the band (see
+ * find_module_fixed_scanline()), transposes the band and runs
+ * decode_columns_ean8() with each estimate. Scratch memory comes from
+ * the context and is released before returning.
+ *
+ * @param[in]  context Context providing the scratch memory
+ * @param[in]  plane   Bit plane
+ * @param[in]  y0      First row of the band
+ * @param[out] result  Caller-owned result; `status` is always set
+ * @param[out] pmatch  Rows of the band (bit k = row y0 + k) that decoded
+ *                     to the digits of `result` (may be NULL)
+ *
+ * @return Same values as decode_columns_ean8(),
+ *         EAN8_ERROR_MEMORY_ALLOCATION if the context is exhausted
+ */
+EAN8Error decode_band_ean8(LineVisionContext* context, const BitPlane* plane, int y0, EAN8Result* result, uint64_t* pmatch);
@@ -0,0 +1,78 @@
+/**
+ * @file consensus.h
+ * @brief Per-digit voting across the scanlines of one barcode
+ *
+ * A damaged barcode (a scratch, a stain, a fold) often fails on a
+ * different digit on each row that crosses it, while the other digits
+ * read fine. Instead of requiring one row that reads all 8 digits, a
+ * DigitConsensus collects the digits of every row, partial reads
+ * included, and votes position by position. Its result is accepted once
+ * every position has a confident majority and the check digit validates.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ean_errors.h"
+#include "ean_patterns.h"
+
+/**
+ * @struct DigitConsensus
+ * @brief Digit votes of the reads of one barcode
+ */
+typedef struct {
+    /** @brief votes[i][d]: reads that gave digit d at position i */
+    uint32_t votes[EAN8_DIGIT_COUNT][10];
+    /** @brief Number of reads added */
+    size_t reads;
+    /** @brief Votes the winning digit of a position needs (at least 1) */
+    size_t min_votes;
+} DigitConsensus;
+
+/**
+ * @brief Empties a consensus
+ *
+ * @param consensus Consensus to initialize
+ * @param min_votes Votes the winning digit of each position needs, on
+ *                  top of a strict majority of the votes of that position
+ */
+void init_digit_consensus(DigitConsensus* consensus, size_t min_votes);
+
+/**
+ * @brief Adds the digits of one read to a consensus
+ *
+ * Reads that decoded (EAN8_ERROR_NONE), failed on the check digit
+ * (EAN8_ERROR_INVALID_CHECKSUM) or failed on some characters
+ * (EAN8_ERROR_INVALID_DECODE, whose EAN8_DIGIT_UNKNOWN digits are
+ * skipped) are counted; other reads carry no digits and are ignored.
+ * Reads with a digit `recovered` from the check digit are ignored too:
+ * that digit always agrees with the checksum of the other seven.
+ *
+ * @param consensus Consensus to update
+ * @param read      Result of one row
+ *
+ * @return `true` if the read was counted
+ */
+bool add_digit_votes(DigitConsensus* consensus, const EAN8Result* read);
+
+/**
+ * @brief Reads the current consensus
+ *
+ * Each position takes its most voted digit, which is confident when it
+ * has at least `min_votes` votes and more than half of the votes of the
+ * position.
+ *
+ * @param[in]  consensus Consensus to read
+ * @param[out] result    Caller-owned result; `status` is always set
+ *
+ * @return The value stored in `result->status`:
+ *         - EAN8_ERROR_NONE: every position confident, check digit valid
+ *         - EAN8_ERROR_INVALID_CHECKSUM: every position confident, check
+ *           digit wrong
+ *         - EAN8_ERROR_INVALID_DECODE: some position is not confident yet
+ *           (its digit is EAN8_DIGIT_UNKNOWN)
+ *         - EAN8_ERROR_INVALID_FORMAT: no read counted yet
+ *         - EAN8_ERROR_INVALID_INPUT: NULL consensus (or NULL result)
+ */
+EAN8Error digit_consensus_result(const DigitConsensus* consensus, EAN8Result* result);
@@ -0,0 +1,109 @@
+/**
+ * @file context.h
+ * @brief Reusable scratch memory for the decoding pipeline
+ *
+ * A LineVisionContext owns one arena from which every per-image scratch
+ * buffer is carved (module histograms, sampled modules, run arrays, row
+ * copies). Allocating is a pointer bump and releasing everything between
+ * two images is a single reset, so a long-lived worker does no heap
+ * allocation once the arena has grown to its working size.
+ *
+ * When a request does not fit, the arena falls back to a separate heap
+ * block, released by the next rewind past it, and grows to the observed
+ * peak on the next reset (warm-up). An empty arena grows in place.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct LineVisionContext
+ * @brief Arena owning the scratch memory of the decoding pipeline
+ */
+typedef struct {
+    /** @brief Start of the arena */
+    uint8_t* base;
+    /** @brief Size of the arena in bytes */
+    size_t capacity;
+    /** @brief Bytes handed out since the last reset */
+    size_t used;
+    /** @brief Largest number of bytes requested between two resets */
+    size_t peak;
+    /** @brief Heap blocks allocated because the arena was full (freed on rewind or reset) */
+    void* overflow;
+} LineVisionContext;
+
+/**
+ * @brief Creates a context with a preallocated arena
+ *
+ * @param capacity Initial arena size in bytes (may be 0; the arena then
+ *                 sizes itself after the first image)
+ *
+ * @return Pointer to a dynamically allocated LineVisionContext, or NULL
+ *         if memory allocation fails
+ *
+ * @note Allocated memory must be freed with destroy_linevision_context()
+ */
+LineVisionContext* create_linevision_context(size_t capacity);
+
+/**
+ * @brief Frees a context and all the memory handed out from it
+ *
+ * @param context Pointer to the context to destroy
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_linevision_context(LineVisionContext* context);
+
+/**
+ * @brief Allocates scratch memory from the context
+ *
+ * The returned memory is aligned for any type, is not initialized, and
+ * stays valid until the next reset_linevision_context().
+ *
+ * @param context Context to allocate from
+ * @param size Number of bytes to allocate
+ *
+ * @return Pointer to the memory, or NULL if the arena is full and the
+ *         fallback heap allocation fails
+ *
+ * @note The memory must not be passed to free()
+ */
+void* linevision_context_alloc(LineVisionContext* context, size_t size);
+
+/**
+ * @brief Returns the current allocation mark of the context
+ *
+ * Together with rewind_linevision_context(), lets a loop release the
+ * scratch memory of one iteration (e.g. one scanline) without resetting
+ * the whole image.
+ *
+ * @param context Context to query
+ *
+ * @return Opaque mark to pass to rewind_linevision_context()
+ */
+size_t linevision_context_mark(const LineVisionContext* context);
+
+/**
+ * @brief Releases the memory handed out since a mark
+ *
+ * @param context Context to rewind
+ * @param mark Value returned by linevision_context_mark() since the last reset
+ *
+ * @note Fallback heap blocks handed out since the mark are freed
+ */
+void rewind_linevision_context(LineVisionContext* context, size_t mark);
+
+/**
+ * @brief Releases all the memory handed out since the last reset
+ *
+ * Rewinds the arena. If an allocation overflowed since the last reset,
+ * the arena is first regrown to the peak usage so that the same workload
+ * fits without heap allocations afterwards.
+ *
+ * @param context Context to reset
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void reset_linevision_context(LineVisionContext* context);
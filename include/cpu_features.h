@@ -0,0 +1,36 @@
+/**
+ * @file cpu_features.h
+ * @brief Runtime detection of the SIMD instruction sets
+ *
+ * Kernels with several implementations (scalar, SSE2, AVX2, ...) pick
+ * one at run time with cpu_features(), so a single binary runs on any
+ * x86-64 CPU and uses the widest instructions available.
+ */
+#pragma once
+
+/**
+ * @enum CpuFeature
+ * @brief Instruction set flags returned by cpu_features()
+ */
+typedef enum {
+    /** @brief SSE2 (always present on x86-64) */
+    CPU_FEATURE_SSE2 = 1 << 0,
+    /** @brief SSSE3 (byte shuffles) */
+    CPU_FEATURE_SSSE3 = 1 << 1,
+    /** @brief SSE4.1 */
+    CPU_FEATURE_SSE41 = 1 << 2,
+    /** @brief AVX2 (256-bit integer vectors) */
+    CPU_FEATURE_AVX2 = 1 << 3,
+    /** @brief POPCNT instruction */
+    CPU_FEATURE_POPCNT = 1 << 4
+} CpuFeature;
+
+/**
+ * @brief Returns the instruction sets supported by the running CPU
+ *
+ * Detection (cpuid) runs once; later calls return the cached value.
+ *
+ * @return Bitwise OR of CpuFeature flags; 0 on non-x86 targets, where
+ *         only the scalar kernels are used
+ */
+unsigned cpu_features(void);
@@ -3,4 +3,55 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "context.h"
+#include "scanline.h"
+
+/** @brief Number of fractional bits of a fixed-point module width */
+#define MODULE_FIXED_SHIFT 16
+
 size_t find_module(const uint8_t* segment, int length);
+
+/**
+ * @brief Estimates the module width of a row from its runs
+ *
+ * Same estimator as find_module() (the most frequent bar width), computed
+ * from the run lengths of an already built scanline instead of walking the
+ * pixels again. The histogram lives on the stack: bars wider than 1024 px
+ * are not counted.
+ *
+ * @param scanline Run-length encoded row
+ *
+ * @return Estimated module width in pixels, or 0 on invalid input
+ */
+size_t find_module_scanline(const Scanline* scanline);
+
+/**
+ * @brief find_module() with its histogram taken from a context
+ *
+ * @param context Context providing the scratch memory
+ * @param segment Binarized pixel row
+ * @param length Number of pixels in the row
+ *
+ * @return Estimated module width in pixels, or 0 on invalid input or
+ *         allocation failure
+ */
+size_t find_module_ctx(LineVisionContext* context, const uint8_t* segment, int length);
+
+/**
+ * @brief Estimates a sub-pixel module width from the guard-to-guard span
+ *
+ * Looks for the first 43-run window, starting at run `from` or later on a
+ * bar, whose guard runs are all within half a module of span / 67, where
+ * span is the width of the window from the start of the start guard to
+ * the end of the end guard. The module width is that span / 67 in fixed
+ * point, which is exact to a fraction of a pixel even when bars are 1.5
+ * or 2 px wide, unlike the integer mode of find_module().
+ *
+ * @param[in]  scanline Run-length encoded row
+ * @param[in]  from     First run to consider
+ * @param[out] prun     Index of the first run of the window (may be NULL)
+ *
+ * @return Module width in pixels with MODULE_FIXED_SHIFT fractional bits,
+ *         or 0 on invalid input or if no window has consistent guards
+ */
+uint32_t find_module_fixed_scanline(const Scanline* scanline, size_t from, size_t* prun);
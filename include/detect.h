@@ -0,0 +1,78 @@
+/**
+ * @file detect.h
+ * @brief Detection of every barcode of an image
+ *
+ * The scan functions of scan.h stop at the first barcode. Multi-detection
+ * decodes each scheduled row completely instead: after a barcode is read,
+ * the search resumes past its end guard, so one row can yield several
+ * barcodes. Reads from all rows are merged into detections by digits and
+ * location in the same pass, so labels carrying several codes need one
+ * pass over the image rather than one crop and rerun per code.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "context.h"
+#include "ean_errors.h"
+#include "ean_patterns.h"
+#include "image.h"
+#include "scan.h"
+
+/**
+ * @struct Detection
+ * @brief One barcode found by scan_all_ean8_parallel()
+ */
+typedef struct {
+    /** @brief Checksum-confirmed digits (`status` is EAN8_ERROR_NONE, never
+     *  `recovered`: reads with a digit solved from the check digit are skipped) */
+    EAN8Result result;
+    /** @brief First pixel of the start guard, leftmost over all rows */
+    int left;
+    /** @brief Pixel past the end guard, rightmost over all rows */
+    int right;
+    /** @brief First row the barcode was read on */
+    int top;
+    /** @brief Last row the barcode was read on */
+    int bottom;
+    /** @brief Number of rows that read it */
+    size_t rows;
+} Detection;
+
+/**
+ * @brief Finds and decodes every barcode along the rows of an image
+ *
+ * Every row of the schedule (`options->row_step`, `options->max_rows`)
+ * is thresholded and searched for all its barcodes, by run width ratios
+ * and then by sub-pixel module sampling in the stretches the first
+ * decoder left. A read joins a detection with the same digits whose
+ * columns overlap it and whose rows are less than half a barcode width
+ * away, so a barcode read on many rows is one detection, while two labels
+ * with the same code far apart stay two. Detections read on fewer than
+ * `options->votes` rows are dropped as likely misreads.
+ *
+ * @param[in]  contexts   One context per worker (not shared between threads)
+ * @param[in]  n_workers  Number of workers, at least 1
+ * @param[in]  gray       Grayscale image (single channel)
+ * @param[in]  threshold  Global threshold
+ * @param[in]  options    Scan options, or NULL for the defaults
+ * @param[out] detections Caller-owned array, sorted top to bottom then
+ *                        left to right
+ * @param[in]  capacity   Number of entries of `detections`; further
+ *                        barcodes are ignored
+ * @param[out] pcount     Number of detections written
+ *
+ * @return EAN8_ERROR_NONE if at least one barcode was found,
+ *         EAN8_ERROR_INVALID_FORMAT if none was,
+ *         EAN8_ERROR_MEMORY_ALLOCATION if a context runs out of memory,
+ *         EAN8_ERROR_INVALID_INPUT on invalid arguments
+ *
+ * @note Rows only: vertical barcodes are found on a transposed image
+ *       (see transpose_u8())
+ */
+EAN8Error scan_all_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, Detection* detections, size_t capacity, size_t* pcount);
+
+/**
+ * @brief Single-threaded scan_all_ean8_parallel()
+ */
+EAN8Error scan_all_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, Detection* detections, size_t capacity, size_t* pcount);
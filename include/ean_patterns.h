@@ -18,12 +18,32 @@
  */
 #pragma once
 
+#include "context.h"
 #include "ean_errors.h"
+#include "scanline.h"
 #include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdbool.h>
 
+/** @brief Total length of an EAN-8 barcode in modules, usable as an array size */
+#define EAN8_MODULE_COUNT 67
+/** @brief Number of digits of an EAN-8 barcode, usable as an array size */
+#define EAN8_DIGIT_COUNT 8
+/** @brief Runs from start guard to end guard, usable as an array size */
+#define EAN8_WINDOW_RUNS 43
+/** @brief Value of a digit that could not be read in a partial result */
+#define EAN8_DIGIT_UNKNOWN 0xFF
+/** @brief Largest Hamming distance, in modules, between an unreadable
+ *  character and the pattern recovered for it from the check digit */
+#define EAN8_ERASURE_MAX_DISTANCE 2
+/** @brief Largest Hamming distance, in modules, at which a character is
+ *  still read as its nearest pattern */
+#define EAN8_MATCH_MAX_DISTANCE 1
+/** @brief Confidence of a read whose every character matched exactly:
+ *  patterns of one set are at least 2 modules apart */
+#define EAN8_CONFIDENCE_EXACT 2
+
 /**
  * @enum SegmentGuard
  * @brief EAN-8 barcode guard patterns
@@ -38,6 +58,57 @@ typedef enum {
     MIDDLE_GUARD = 0b01010
 } SegmentGuard;
 
+/**
+ * @enum EANCodeSet
+ * @brief Encoding set (parity) of a 7-module digit pattern
+ */
+typedef enum {
+    /** @brief Not a valid digit pattern */
+    EAN_SET_NONE = 0,
+    /** @brief L-set: left-hand digits, odd parity */
+    EAN_SET_L = 1,
+    /** @brief G-set: left-hand digits, even parity (EAN-13 only) */
+    EAN_SET_G = 2,
+    /** @brief R-set: right-hand digits */
+    EAN_SET_R = 3
+} EANCodeSet;
+
+/**
+ * @struct EANCodeEntry
+ * @brief Entry of the 7-bit pattern lookup table
+ *
+ * The `digit` field is only meaningful when the matching set is not
+ * EAN_SET_NONE.
+ */
+typedef struct {
+    /** @brief Digit encoded by the pattern */
+    uint8_t digit;
+    /** @brief Set of the pattern (EANCodeSet) */
+    uint8_t set;
+    /** @brief Digit encoded by the bit-reversed pattern */
+    uint8_t reversed_digit;
+    /** @brief Set of the bit-reversed pattern (EANCodeSet) */
+    uint8_t reversed_set;
+} EANCodeEntry;
+
+/** @brief Bit of an EANCodeSet in the `sets` mask of match_code_ean() */
+#define EAN_SET_MASK(set) (1u << (set))
+
+/**
+ * @struct EANCodeMatch
+ * @brief Nearest digit pattern to 7 sampled modules, see match_code_ean()
+ */
+typedef struct {
+    /** @brief Digit of the nearest pattern */
+    uint8_t digit;
+    /** @brief Set of the nearest pattern (EANCodeSet) */
+    uint8_t set;
+    /** @brief Modules differing from the nearest pattern (Hamming distance) */
+    uint8_t distance;
+    /** @brief Distance of the runner-up pattern minus `distance`, 0 on a tie */
+    uint8_t margin;
+} EANCodeMatch;
+
 /**
  * @struct SegmentEAN
  * @brief Represents a decoded EAN-8 barcode segment
@@ -53,6 +124,43 @@ typedef struct {
     uint8_t* data;
 } SegmentEAN;
 
+/**
+ * @struct EAN8Segment
+ * @brief Fixed-size EAN-8 segment stored in caller-owned memory
+ *
+ * Allocation-free counterpart of SegmentEAN: only the 67 modules of the
+ * barcode are kept, so the start, middle and end guards are always at
+ * indices 0, 31 and 64 of `data`.
+ */
+typedef struct {
+    /** @brief Index of the start guard in the sampled row (in modules) */
+    size_t start;
+    /** @brief Modules from start guard to end guard (1 = bar, 0 = space) */
+    uint8_t data[EAN8_MODULE_COUNT];
+} EAN8Segment;
+
+/**
+ * @struct EAN8Result
+ * @brief Fixed-size EAN-8 decoding result stored in caller-owned memory
+ */
+typedef struct {
+    /** @brief Decoded digits (4 from L-set followed by 4 from R-set) */
+    uint8_t digits[EAN8_DIGIT_COUNT];
+    /** @brief Outcome of the decoding; digits are valid for EAN8_ERROR_NONE
+     *  and EAN8_ERROR_INVALID_CHECKSUM, and for EAN8_ERROR_INVALID_DECODE
+     *  the unreadable ones are EAN8_DIGIT_UNKNOWN */
+    EAN8Error status;
+    /** @brief Reduced confidence: one unreadable digit was filled in from
+     *  the check digit (only ever set with EAN8_ERROR_NONE) */
+    bool recovered;
+    /** @brief Smallest runner-up margin less the modules corrected, over
+     *  the digits: EAN8_CONFIDENCE_EXACT when every character matched
+     *  exactly, 1 when one was read at EAN8_MATCH_MAX_DISTANCE (or the
+     *  digits were voted across rows), 0 when one was recovered; only
+     *  meaningful with digits */
+    uint8_t confidence;
+} EAN8Result;
+
 extern const size_t EAN8_DIGITS;
 extern const size_t EAN13_DIGITS;
 
@@ -62,6 +170,8 @@ extern const size_t EAN8_LENGTH;
 extern const size_t EAN8_SET_LENGTH;
 /** @brief Length of an individual code in modules */
 extern const size_t EAN8_CODE_LENGTH;
+/** @brief Number of runs (bars and spaces) in an EAN-8 barcode: 3 + 16 + 5 + 16 + 3 */
+extern const size_t EAN8_RUN_COUNT;
 
 /**
  * @brief Encoding table for L-set (left-side digits)
@@ -77,6 +187,21 @@ extern const int L_CODE[10];
  * encoding according to the EAN-8 standard.
  */
 extern const int R_CODE[10];
+/**
+ * @brief Encoding table for G-set (EAN-13 even parity left-side digits)
+ *
+ * Each G pattern is the bit-reversed R pattern of the same digit.
+ */
+extern const int G_CODE[10];
+
+/**
+ * @brief Lookup table indexed by a 7-bit digit pattern
+ *
+ * Gives, in a single load, the digit and set (L, G or R) of a pattern and
+ * of its bit-reversed pattern, so that characters read right to left decode
+ * with the same probe.
+ */
+extern const EANCodeEntry EAN_CODE_TABLE[128];
 
 /**
  * @brief Creates and initializes an EAN segment from raw pixel data
@@ -108,6 +233,148 @@ extern const int R_CODE[10];
  */
 SegmentEAN* create_segment_ean(const uint8_t* data, size_t length, size_t module);
 
+/**
+ * @brief create_segment_ean() with all its memory taken from a context
+ *
+ * @param context Context providing the memory
+ * @param data Pointer to binarized pixel data (0 or 255 values)
+ * @param length Total length of pixel data
+ * @param module Width of one barcode module in pixels (sampling rate)
+ *
+ * @return Pointer to a SegmentEAN living in the context, or NULL if the
+ *         allocation fails or no valid EAN-8 structure is found
+ *
+ * @note Must not be passed to destroy_segment_ean(); the memory is
+ *       released by reset_linevision_context()
+ */
+SegmentEAN* create_segment_ean_ctx(LineVisionContext* context, const uint8_t* data, size_t length, size_t module);
+
+/**
+ * @brief Creates an EAN segment from a run-length encoded row
+ *
+ * Run-length counterpart of create_segment_ean(). Each run is quantized to
+ * a whole number of modules (rounded, at least one), and the EAN-8
+ * structure is searched directly on the runs: a valid candidate is a bar
+ * run starting 43 alternating runs whose guard runs are one module wide
+ * and whose total width is 67 modules. Its modules are then read at their
+ * centers with sample_segment_ean8_scanline(), the module width being the
+ * width of the 43 runs over 67. The work is proportional to the number of
+ * runs, not to the number of pixels.
+ *
+ * @param scanline Run-length encoded row (see build_scanline())
+ * @param module Width of one barcode module in pixels
+ *
+ * @return Pointer to a dynamically allocated new SegmentEAN with valid structure,
+ *         or NULL if memory allocation fails or no valid EAN-8 structure is found
+ *
+ * @note Allocated memory must be freed with destroy_segment_ean()
+ * @note The segment data holds only the 67 modules of the barcode, so
+ *       start is 0 and middle and end are 31 and 64
+ */
+SegmentEAN* create_segment_ean_scanline(const Scanline* scanline, size_t module);
+
+/**
+ * @brief create_segment_ean_scanline() with all its memory taken from a context
+ *
+ * @param context Context providing the memory
+ * @param scanline Run-length encoded row (see build_scanline())
+ * @param module Width of one barcode module in pixels
+ *
+ * @return Pointer to a SegmentEAN living in the context, or NULL if the
+ *         allocation fails or no valid EAN-8 structure is found
+ *
+ * @note Must not be passed to destroy_segment_ean(); the memory is
+ *       released by reset_linevision_context()
+ */
+SegmentEAN* create_segment_ean_scanline_ctx(LineVisionContext* context, const Scanline* scanline, size_t module);
+
+/**
+ * @brief Finds an EAN-8 structure in raw pixel data without allocating
+ *
+ * Same sampling and search as create_segment_ean(), but the sampled
+ * modules are packed by fixed-size chunks on the stack and only the 67
+ * modules of the barcode are written to the caller's segment.
+ *
+ * @param[in]  data    Pointer to binarized pixel data (0 or 255 values)
+ * @param[in]  length  Total length of pixel data
+ * @param[in]  module  Width of one barcode module in pixels
+ * @param[out] segment Caller-owned segment to fill
+ *
+ * @return EAN8_ERROR_NONE if a structure was found,
+ *         EAN8_ERROR_INVALID_FORMAT if there is none,
+ *         EAN8_ERROR_INVALID_INPUT on NULL pointers or a zero module
+ */
+EAN8Error find_segment_ean8(const uint8_t* data, size_t length, size_t module, EAN8Segment* segment);
+
+/**
+ * @brief Finds an EAN-8 structure in a scanline without allocating
+ *
+ * Same search and sampling as create_segment_ean_scanline(), writing the
+ * 67 modules of the barcode to the caller's segment. `start` is the
+ * start guard in modules of the sampled width (see
+ * sample_segment_ean8_scanline()); the pixel where the barcode begins and
+ * the sampled width are returned separately.
+ *
+ * @param[in]  scanline Run-length encoded row
+ * @param[in]  module   Width of one barcode module in pixels
+ * @param[out] segment  Caller-owned segment to fill
+ * @param[out] pstart   Pixel where the start guard begins (may be NULL)
+ * @param[out] pfixed   Sampled module width with MODULE_FIXED_SHIFT
+ *                      fractional bits (may be NULL)
+ *
+ * @return EAN8_ERROR_NONE if a structure was found,
+ *         EAN8_ERROR_INVALID_FORMAT if there is none,
+ *         EAN8_ERROR_INVALID_INPUT on NULL pointers or a zero module
+ */
+EAN8Error find_segment_ean8_scanline(const Scanline* scanline, size_t module, EAN8Segment* segment, size_t* pstart, uint32_t* pfixed);
+
+/**
+ * @brief Samples an EAN-8 segment from a scanline with a fractional module
+ *
+ * Reads the 67 modules at their centers, start + (i + 1/2) * module, with
+ * a fixed-point accumulator instead of multiplying an integer module
+ * width, so that rounding errors do not add up over the barcode.
+ *
+ * @param[in]  scanline Run-length encoded row
+ * @param[in]  start    Pixel where the start guard begins
+ * @param[in]  module   Module width with MODULE_FIXED_SHIFT fractional
+ *                      bits, e.g. from find_module_fixed_scanline()
+ * @param[out] segment  Caller-owned segment to fill
+ *
+ * @return EAN8_ERROR_NONE if the sampled modules have valid guards,
+ *         EAN8_ERROR_INVALID_FORMAT if they do not or the barcode would
+ *         end past the row,
+ *         EAN8_ERROR_INVALID_INPUT on NULL pointers or a zero module
+ */
+EAN8Error sample_segment_ean8_scanline(const Scanline* scanline, size_t start, uint32_t module, EAN8Segment* segment);
+
+/**
+ * @brief Finds an EAN-8 structure in a packed bit row without allocating
+ *
+ * Same search as find_segment_ean8() on a row of a BitPlane. With a
+ * module of one pixel the row is already the packed module bitstream and
+ * is searched in place; otherwise one bit every `module` pixels is
+ * sampled into stack chunks.
+ *
+ * @param[in]  bits    Packed row (1 = bar), readable up to
+ *                     packed_modules_words(length) words
+ * @param[in]  length  Number of pixels in the row
+ * @param[in]  module  Width of one barcode module in pixels
+ * @param[out] segment Caller-owned segment to fill
+ *
+ * @return EAN8_ERROR_NONE if a structure was found,
+ *         EAN8_ERROR_INVALID_FORMAT if there is none,
+ *         EAN8_ERROR_INVALID_INPUT on NULL pointers or a zero module
+ */
+EAN8Error find_segment_ean8_bits(const uint64_t* bits, size_t length, size_t module, EAN8Segment* segment);
+
+/**
+ * @brief Prints the 67 modules of a fixed-size segment to standard output
+ *
+ * @param segment Pointer to the segment to display
+ */
+void print_segment_ean8(const EAN8Segment* segment);
+
 /**
  * @brief Frees the memory allocated for an EAN segment
  *
@@ -156,13 +423,70 @@ void print_segment_ean(SegmentEAN* segment);
  */
 bool is_valid_structure(const uint8_t* data, size_t length, size_t index);
 
+/**
+ * @brief Number of 64-bit words needed to pack a module bitstream
+ *
+ * Includes the padding words read past the end of the bitstream by
+ * find_structure_packed().
+ *
+ * @param length Length of the bitstream in modules
+ *
+ * @return Number of words to allocate for pack_modules()
+ */
+size_t packed_modules_words(size_t length);
+
+/**
+ * @brief Packs one value per module into 64-bit words
+ *
+ * Module `i` is stored in bit `i % 64` of `words[i / 64]`. Padding words
+ * are zeroed.
+ *
+ * @param data   Pointer to the binary bitstream (values 0 or 1 only).
+ * @param length Length of the bitstream in modules.
+ * @param words  Output buffer of packed_modules_words(length) words.
+ */
+void pack_modules(const uint8_t* data, size_t length, uint64_t* words);
+
+/**
+ * @brief Finds the first valid EAN-8 structure in a packed bitstream
+ *
+ * Bit-parallel equivalent of calling is_valid_structure() at every index:
+ * for 64 consecutive candidate offsets at a time, the bitstream is read
+ * shifted by each guard bit position (0, 1, 2, 31..35, 64, 65, 66) and the
+ * shifted words are combined with AND / AND NOT. Each set bit of the
+ * result is an offset where all three guards match.
+ *
+ * @param words  Bitstream packed with pack_modules().
+ * @param length Length of the bitstream in modules.
+ * @param from   First offset to consider.
+ *
+ * @return Index of the first valid structure at or after `from`, or
+ *         `length` if there is none.
+ */
+size_t find_structure_packed(const uint64_t* words, size_t length, size_t from);
+
 int compute_check_digit(const int* segment, const size_t size);
 
+/**
+ * @brief Solves the checksum for one missing digit
+ *
+ * EAN weights are 3 and 1, both invertible modulo 10, so the check digit
+ * equation has exactly one solution for any single unknown position.
+ *
+ * @param segment  Digits, the one at `position` is ignored
+ * @param size     Number of digits, the last one being the check digit
+ * @param position Index of the missing digit
+ *
+ * @return The only value of `segment[position]` that makes the checksum
+ *         valid, or -1 if `position` is out of range
+ */
+int solve_check_digit(const int* segment, const size_t size, const size_t position);
+
 /**
  * @brief Decodes an individual 7-bit code
  *
- * Compares the provided 7 bits with the encoding tables to identify
- * the corresponding digit.
+ * Looks the provided 7 bits up in EAN_CODE_TABLE and accepts the digit
+ * if its pattern belongs to the given encoding table.
  *
  * @param data Pointer to 7 bits of data (uint8_t[7])
  * @param codes Encoding table to use (L_CODE or R_CODE)
@@ -171,6 +495,37 @@ int compute_check_digit(const int* segment, const size_t size);
  */
 int decode_code_ean8(const uint8_t* data, const int codes[10]);
 
+/**
+ * @brief Looks up an individual 7-bit code in every set at once
+ *
+ * @param data Pointer to 7 bits of data (uint8_t[7])
+ *
+ * @return The EAN_CODE_TABLE entry of the pattern, giving its digit and set
+ *         as read and as read in reverse
+ */
+EANCodeEntry lookup_code_ean(const uint8_t* data);
+
+/**
+ * @brief Finds the nearest digit pattern to 7 possibly damaged modules
+ *
+ * Tolerant counterpart of decode_code_ean8(). The Hamming distance to the
+ * 30 L, G and R patterns is computed at once, as popcount(value ^ pattern)
+ * with a nibble lookup in SSSE3 registers (scalar popcount otherwise).
+ * Each distance is packed with its pattern index into one byte, so the
+ * nearest and runner-up patterns are two horizontal minimums.
+ *
+ * @param data Pointer to 7 bits of data (uint8_t[7])
+ * @param sets Sets to consider, EAN_SET_MASK() of one or more EANCodeSet
+ *
+ * @return The nearest pattern of the given sets with its distance, and its
+ *         margin over the runner-up of the same sets
+ *
+ * @note Patterns of one set are at least 2 modules apart, so a single
+ *       damaged module leaves the right pattern nearest with a margin of
+ *       2 or ties it with another one (margin 0).
+ */
+EANCodeMatch match_code_ean(const uint8_t* data, unsigned sets);
+
 /**
  * @brief Decodes the 4 digits of the left set (L-set)
  *
@@ -220,3 +575,86 @@ int* decode_right_set_ean8(const SegmentEAN* segment);
  * perror but still returns the allocated digits.
  */
 int* decode_ean8(const SegmentEAN* segment, EAN8Error* perror);
+
+/**
+ * @brief Decodes a fixed-size EAN-8 segment into a caller-owned result
+ *
+ * Allocation-free counterpart of decode_ean8().
+ *
+ * @param[in]  segment Segment found by find_segment_ean8() or
+ *                     find_segment_ean8_scanline()
+ * @param[out] result  Caller-owned result; `status` is always set
+ *
+ * @return The value stored in `result->status`:
+ *         - EAN8_ERROR_NONE: digits decoded and check digit valid
+ *         - EAN8_ERROR_INVALID_CHECKSUM: digits decoded, check digit wrong
+ *         - EAN8_ERROR_INVALID_DECODE: a digit pattern is unknown (the
+ *           other digits are still read)
+ *         - EAN8_ERROR_INVALID_INPUT: NULL segment (or NULL result)
+ *
+ * @note The guards are symmetric, so a barcode sampled right to left
+ *       yields a valid segment too. The reading direction is chosen from
+ *       the EAN_CODE_TABLE entries of the characters (L and R patterns
+ *       as sampled, or bit-reversed R and L patterns), and the digits are
+ *       always returned in barcode order.
+ * @note Characters are read with match_code_ean(): a pattern with one
+ *       damaged module is accepted when it is nearer to one digit than
+ *       to any other, leaving the checksum to confirm it.
+ * @note When exactly one character is unreadable and at most one other
+ *       was matched within a module rather than exactly, its value is
+ *       solved from the check digit with solve_check_digit() and kept
+ *       only if the expected pattern is within EAN8_ERASURE_MAX_DISTANCE
+ *       modules of the sampled one. The result is then EAN8_ERROR_NONE
+ *       with `recovered` set; as the checksum was spent on the recovery,
+ *       it no longer confirms the read.
+ */
+EAN8Error decode_segment_ean8(const EAN8Segment* segment, EAN8Result* result);
+
+/**
+ * @brief Decodes an EAN-8 barcode from the run widths of a scanline
+ *
+ * Module-free alternative to find_module_scanline() followed by
+ * find_segment_ean8_scanline() and decode_segment_ean8(). Each
+ * 43-run window starting on a bar is accepted as a barcode when its guard
+ * runs are about 1/67 of the window span. Digits are then read from the
+ * edge-to-similar-edge distances of each character: with p the width of
+ * the 4 runs of a character, t1 = r0 + r1 and t2 = r1 + r2 are rounded to
+ * 7 * t / p modules. The pairs shared by 1/7 and 2/8 are told apart by
+ * the total bar width. Only ratios within a character are used, so
+ * fractional module widths (e.g. 2.6 px) and blur that widens every bar
+ * by the same amount do not need any resampling. A window read right to
+ * left, told apart by the even bar widths of its first characters
+ * (bit-reversed R patterns), is decoded from its last run.
+ *
+ * @param[in]  scanline Run-length encoded row
+ * @param[out] result   Caller-owned result; `status` is always set
+ * @param[out] prun     Index of the first guard run of the decoded window
+ *                      (may be NULL)
+ *
+ * @return The value stored in `result->status`:
+ *         - EAN8_ERROR_NONE: digits decoded and check digit valid
+ *         - EAN8_ERROR_INVALID_CHECKSUM: best window decoded, check digit wrong
+ *         - EAN8_ERROR_INVALID_DECODE: guards found, a character is unknown
+ *           (the other digits are still read)
+ *         - EAN8_ERROR_INVALID_FORMAT: no window has valid guards
+ *         - EAN8_ERROR_INVALID_INPUT: NULL scanline (or NULL result)
+ */
+EAN8Error decode_scanline_edges_ean8(const Scanline* scanline, EAN8Result* result, size_t* prun);
+
+/**
+ * @brief decode_scanline_edges_ean8() from a given run on
+ *
+ * Only windows starting at run `from` or later are considered, so that a
+ * row can be searched for several barcodes, each search resuming after
+ * the window of the previous one.
+ *
+ * @param[in]  scanline Run-length encoded row
+ * @param[in]  from     First run to consider
+ * @param[out] result   Caller-owned result; `status` is always set
+ * @param[out] prun     Index of the first guard run of the decoded window
+ *                      (may be NULL)
+ *
+ * @return The value stored in `result->status` (see
+ *         decode_scanline_edges_ean8())
+ */
+EAN8Error decode_scanline_edges_ean8_from(const Scanline* scanline, size_t from, EAN8Result* result, size_t* prun);
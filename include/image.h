@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -39,6 +40,45 @@ typedef struct {
     unsigned char* data;
 } Image;
 
+/**
+ * @enum BinarizationMethod
+ * @brief How pixels are classified as black or white
+ */
+typedef enum {
+    /** @brief One threshold for the whole image (fixed or Otsu) */
+    BINARIZATION_GLOBAL = 0,
+    /** @brief Threshold relative to the mean of a window around each
+     *  pixel (Bradley), for unevenly lit images */
+    BINARIZATION_ADAPTIVE = 1
+} BinarizationMethod;
+
+/**
+ * @enum ImageOrientation
+ * @brief Direction in which a barcode is read
+ */
+typedef enum {
+    /** @brief Bars are vertical, the barcode is read along rows */
+    ORIENTATION_HORIZONTAL = 0,
+    /** @brief Bars are horizontal, the barcode is read along columns */
+    ORIENTATION_VERTICAL = 1
+} ImageOrientation;
+
+/**
+ * @struct BinarizationOptions
+ * @brief Parameters of binarization_with_options()
+ */
+typedef struct {
+    /** @brief Classification method */
+    BinarizationMethod method;
+    /** @brief Global threshold (0-255); negative to use otsu_threshold() */
+    int threshold;
+    /** @brief Adaptive: side of the square window in pixels */
+    int window;
+    /** @brief Adaptive: a pixel is black when it is at least this many
+     *  percent darker than its window mean */
+    int sensitivity;
+} BinarizationOptions;
+
 /**
  * @brief Loads an image from a file
  *
@@ -138,6 +178,7 @@ void print_image_info(Image* image);
  * @note The input must be grayscale (single channel) data
  * @note For color images, convert to grayscale first before calling this function with rgb_to_grayscale(image);
  * @note Time complexity: O(length + 256) ≈ O(length)
+ * @note The histogram is built with histogram_u8() (sub-histograms)
  *
  * @example
  * int threshold = otsu_threshold(image->data, image->width * image->height);
@@ -145,6 +186,55 @@ void print_image_info(Image* image);
  */
 int otsu_threshold(const uint8_t* gray, int length);
 
+/**
+ * @brief Calculates the Otsu threshold from an existing histogram
+ *
+ * Second half of otsu_threshold(), for callers that already have the
+ * histogram (e.g. from rgb_to_grayscale_histogram()).
+ *
+ * @param histogram 256-bin histogram of gray levels
+ * @param length Total number of pixels counted in the histogram
+ *
+ * @return Optimal threshold value (0-255) that maximizes inter-class variance
+ */
+int otsu_threshold_histogram(const int histogram[256], int length);
+
+/**
+ * @brief Calculates the Otsu threshold from a subsampled histogram
+ *
+ * Builds the histogram from every `step`-th pixel of every `step`-th row
+ * only, which costs 1/step² of a full pass and is usually enough to place
+ * the threshold between the bars and the background.
+ *
+ * @param image Grayscale image (single channel)
+ * @param step Sampling step in both directions (1 = every pixel)
+ *
+ * @return Optimal threshold value (0-255) for the sampled pixels, or 0 on
+ *         invalid input
+ *
+ * @example
+ * int threshold = otsu_threshold_subsampled(image, 8);
+ */
+int otsu_threshold_subsampled(const Image* image, int step);
+
+/**
+ * @brief Guesses whether the barcode of an image is horizontal or vertical
+ *
+ * Counts black/white transitions on `samples` evenly spaced rows and as
+ * many columns. Bars crossed perpendicularly give many transitions, so
+ * the direction with the higher transition density (per pixel walked) is
+ * the reading direction. Only a few lines are read, which costs far less
+ * than scanning in the wrong direction.
+ *
+ * @param gray Grayscale image (single channel)
+ * @param threshold Threshold separating black from white
+ * @param samples Number of rows and of columns to sample (at least 1)
+ *
+ * @return ORIENTATION_VERTICAL if columns have more transitions,
+ *         ORIENTATION_HORIZONTAL otherwise or on invalid input
+ */
+ImageOrientation detect_orientation(const Image* gray, int threshold, int samples);
+
 /**
  * @brief Converts an image to binary using a threshold
  *
@@ -162,6 +252,7 @@ int otsu_threshold(const uint8_t* gray, int length);
  * @note The image is modified directly; no new image is created
  * @note Works with grayscale images (single channel)
  * @note For optimal results, use threshold from otsu_threshold()
+ * @note Uses the AVX2/SSE2 threshold_u8() kernel when the CPU supports it
  *
  * @example
  * // Automatic binarization using Otsu's method
@@ -173,9 +264,98 @@ int otsu_threshold(const uint8_t* gray, int length);
  */
 void binarization(Image* image, int threshold);
 
-// Convert RGB image to grayscale
+/**
+ * @brief Fills binarization options with the defaults
+ *
+ * Global Otsu threshold; adaptive parameters set to a 1/8 image-width
+ * window (chosen at binarization time when `window` is 0) and a 15%
+ * sensitivity, for when `method` is switched to BINARIZATION_ADAPTIVE.
+ *
+ * @param options Options to initialize
+ */
+void default_binarization_options(BinarizationOptions* options);
+
+/**
+ * @brief Binarizes an image in place with the selected method
+ *
+ * Generalization of binarization(): BINARIZATION_GLOBAL applies the
+ * given (or Otsu) threshold; BINARIZATION_ADAPTIVE compares each pixel
+ * with the mean of the window centered on it. Window sums come from
+ * running column sums and a row prefix sum, so each pixel costs O(1)
+ * whatever the window size (see binarize_bitplane_with_options()).
+ *
+ * @param image Pointer to the grayscale image to binarize (modified in-place)
+ * @param options Binarization options, or NULL for the defaults
+ *
+ * @return `true` on success, `false` on invalid input or memory
+ *         allocation failure (the image is then left unchanged)
+ *
+ * @example
+ * BinarizationOptions options;
+ * default_binarization_options(&options);
+ * options.method = BINARIZATION_ADAPTIVE;
+ * binarization_with_options(image, &options);
+ */
+bool binarization_with_options(Image* image, const BinarizationOptions* options);
+
+/**
+ * @brief Converts an image to grayscale in place
+ *
+ * RGB and RGBA pixels are converted to luma with fixed-point BT.601
+ * weights (see rgb_to_luma_u8()); the alpha channel is ignored. Gray +
+ * alpha images keep their gray channel. The pixel buffer is reused, only
+ * its first width * height bytes remain meaningful, and `channels`
+ * becomes 1.
+ *
+ * @param image Pointer to the image to convert (modified in-place)
+ *
+ * @note Safe to call with NULL pointer (does nothing)
+ * @note Does nothing more than setting `channels` for grayscale images
+ *
+ * @example
+ * Image* img = open_image("barcode.png", 0); // keep the file channels
+ * rgb_to_grayscale(img);
+ */
 void rgb_to_grayscale(Image* image);
 
+/**
+ * @brief Converts an image to grayscale and builds its histogram in one pass
+ *
+ * Same conversion as rgb_to_grayscale(), with the 256-bin histogram of
+ * the resulting gray levels counted block by block right after each
+ * block is stored, while it is still in L1 cache, so
+ * otsu_threshold_histogram() needs no extra pass over the image.
+ *
+ * @param image Pointer to the image to convert (modified in-place)
+ * @param histogram Histogram to add the gray level counts to (not
+ *                  cleared), or NULL
+ *
+ * @example
+ * int histogram[256] = {0};
+ * rgb_to_grayscale_histogram(img, histogram);
+ * int threshold = otsu_threshold_histogram(histogram, img->width * img->height);
+ */
+void rgb_to_grayscale_histogram(Image* image, int histogram[256]);
+
+/**
+ * @brief Converts an image to grayscale and returns its Otsu threshold
+ *
+ * Color images are converted with rgb_to_grayscale_histogram(), so the
+ * threshold comes from the full histogram at no extra read. Images that
+ * are already grayscale have no conversion pass to share, and use
+ * otsu_threshold_subsampled() instead.
+ *
+ * @param image Pointer to the image to convert (modified in-place)
+ * @param step Sampling step for grayscale input (see
+ *             otsu_threshold_subsampled())
+ *
+ * @return Optimal threshold value (0-255), or 0 on invalid input
+ *
+ * @example
+ * int threshold = rgb_to_grayscale_otsu(img, 8);
+ */
+int rgb_to_grayscale_otsu(Image* image, int step);
+
 /**
  * @brief Saves an image to a PNG file
  *
@@ -0,0 +1,110 @@
+/**
+ * @file image_kernels.h
+ * @brief Per-pixel kernels with runtime SIMD dispatch
+ *
+ * Hot loops that touch every pixel of an image. Each kernel has a scalar
+ * implementation and, on x86, SSE2/AVX2 variants selected at run time
+ * with cpu_features(). All variants produce identical results.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Accumulates the 256-bin histogram of 8-bit pixels
+ *
+ * Pixels are counted into four interleaved sub-histograms that are summed
+ * at the end, so that runs of equal pixels do not serialize on the same
+ * counter (store-to-load forwarding stalls).
+ *
+ * @param pixels Pointer to 8-bit pixels
+ * @param length Number of pixels
+ * @param histogram Histogram to add the counts to (not cleared)
+ */
+void histogram_u8(const uint8_t* pixels, size_t length, int histogram[256]);
+
+/**
+ * @brief Thresholds 8-bit pixels to 0 / 255
+ *
+ * Writes 255 where `src[i] > threshold` and 0 elsewhere, 32 pixels per
+ * step with AVX2 (16 with SSE2).
+ *
+ * @param src Source pixels
+ * @param dst Destination pixels (may be equal to `src`)
+ * @param length Number of pixels
+ * @param threshold Threshold; values below 0 or above 255 are allowed
+ */
+void threshold_u8(const uint8_t* src, uint8_t* dst, size_t length, int threshold);
+
+/**
+ * @brief Converts interleaved color pixels to 8-bit luma
+ *
+ * luma = (38 R + 75 G + 15 B + 64) >> 7, i.e. the BT.601 weights
+ * (0.299, 0.587, 0.114) in 7-bit fixed point. The alpha channel is
+ * ignored; 2-channel pixels (gray + alpha) keep their gray value.
+ *
+ * With SSSE3 (RGB, RGBA) or AVX2 (RGBA), 16 or 32 pixels are converted
+ * per step. The luma histogram is accumulated in the same pass, each
+ * block being counted right after it is stored, which saves a second
+ * read of the image before otsu_threshold_histogram().
+ *
+ * @param src Interleaved source pixels
+ * @param dst Destination luma, one byte per pixel (may be equal to `src`)
+ * @param n_pixels Number of pixels
+ * @param channels Channels per source pixel (1 to 4)
+ * @param histogram Histogram to add the luma counts to (not cleared), or NULL
+ */
+void rgb_to_luma_u8(const uint8_t* src, uint8_t* dst, size_t n_pixels, int channels, int histogram[256]);
+
+/**
+ * @brief Thresholds 8-bit pixels into a packed bit row
+ *
+ * Sets bit `i % 64` of `bits[i / 64]` when `src[i] <= threshold` (black,
+ * i.e. a bar) and clears it otherwise; the bits past `length` in the last
+ * word are cleared. With AVX2 (SSE2), 32 (16) pixels are compared per
+ * instruction and their movemask is stored directly.
+ *
+ * @param src Source pixels
+ * @param length Number of pixels
+ * @param threshold Threshold; values below 0 or above 255 are allowed
+ * @param bits Destination, (length + 63) / 64 words
+ */
+void threshold_pack_u8(const uint8_t* src, size_t length, int threshold, uint64_t* bits);
+
+/**
+ * @brief Transposes a block of 8-bit pixels
+ *
+ * Writes `dst[x * dst_stride + y] = src[y * src_stride + x]`, turning the
+ * columns of the source into rows of the destination. The work is split
+ * into 64x64 blocks so that the 64 source rows and 64 destination rows in
+ * flight stay in L1, instead of a column walk missing the cache on every
+ * pixel. With SSE2, each block is transposed as 16x16 tiles held in
+ * registers.
+ *
+ * @param src Source pixels
+ * @param src_stride Bytes between two source rows
+ * @param width Source width (destination height)
+ * @param height Source height (destination width)
+ * @param dst Destination pixels, not overlapping the source
+ * @param dst_stride Bytes between two destination rows, at least `height`
+ */
+void transpose_u8(const uint8_t* src, size_t src_stride, size_t width, size_t height, uint8_t* dst, size_t dst_stride);
+
+/**
+ * @brief Halves a block of 8-bit pixels with a 2x2 box filter
+ *
+ * Writes `dst[y * dst_stride + x]` as the rounded mean of the source
+ * pixels (2x, 2y), (2x + 1, 2y), (2x, 2y + 1) and (2x + 1, 2y + 1), for
+ * a destination of width / 2 by height / 2 pixels (an odd last row or
+ * column is dropped). With AVX2 (SSE2), 32 (16) destination pixels are
+ * produced per step from 16-bit pair sums of the even and odd bytes.
+ *
+ * @param src Source pixels
+ * @param src_stride Bytes between two source rows
+ * @param width Source width
+ * @param height Source height
+ * @param dst Destination pixels, not overlapping the source
+ * @param dst_stride Bytes between two destination rows, at least `width / 2`
+ */
+void downsample_2x_u8(const uint8_t* src, size_t src_stride, size_t width, size_t height, uint8_t* dst, size_t dst_stride);
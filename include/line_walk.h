@@ -0,0 +1,148 @@
+/**
+ * @file line_walk.h
+ * @brief Precomputed pixel walks along angled scanlines
+ *
+ * Barcodes tilted by more than a few degrees never cross a horizontal row
+ * from guard to guard. A LineWalk holds, for one angle and one image
+ * size, the integer offsets of the pixels met when stepping along a line
+ * one pixel at a time on its major axis (Bresenham-style rounding of the
+ * minor axis). Sampling any line of that angle is then a table lookup
+ * per pixel, about the cost of copying a row, and the sampled line can be
+ * decoded exactly like a row (see decode_row_gray_ean8()).
+ *
+ * Angles are in degrees, counterclockwise from the x axis as seen on the
+ * image (y grows downwards), in (-90, 90] so that lines are always read
+ * from left to right, or upwards when vertical.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+
+/**
+ * @struct LineWalk
+ * @brief Pixel offsets along a line of a given angle
+ */
+typedef struct {
+    /** @brief Angle of the lines in degrees */
+    int angle;
+    /** @brief Width of the images walked, in pixels */
+    int width;
+    /** @brief Height of the images walked, in pixels */
+    int height;
+    /** @brief Number of steps stored for each half-line */
+    size_t length;
+    /** @brief Horizontal offset of step i from the line center */
+    int* dx;
+    /** @brief Vertical offset of step i from the line center */
+    int* dy;
+    /** @brief Offset of step i in the pixel buffer, dy * width + dx */
+    ptrdiff_t* offsets;
+} LineWalk;
+
+/**
+ * @struct LinePosition
+ * @brief Scanline a result was read from
+ */
+typedef struct {
+    /** @brief Column of the center of the line */
+    int x;
+    /** @brief Row of the center of the line */
+    int y;
+    /** @brief Angle of the line in degrees (0 = row) */
+    int angle;
+} LinePosition;
+
+/**
+ * @brief Precomputes the walk of lines of an angle over images of a size
+ *
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param angle Angle in degrees, in (-90, 90]
+ *
+ * @return Pointer to a dynamically allocated LineWalk, or NULL on invalid
+ *         input or memory allocation failure
+ *
+ * @note Allocated memory must be freed with destroy_line_walk()
+ */
+LineWalk* create_line_walk(int width, int height, int angle);
+
+/**
+ * @brief Precomputes a line walk in memory taken from a context
+ *
+ * @param context Context providing the memory
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param angle Angle in degrees, in (-90, 90]
+ *
+ * @return Pointer to a LineWalk living in the context, or NULL on invalid
+ *         input or allocation failure
+ *
+ * @note Must not be passed to destroy_line_walk(); the memory is released
+ *       by reset_linevision_context()
+ */
+LineWalk* create_line_walk_ctx(LineVisionContext* context, int width, int height, int angle);
+
+/**
+ * @brief Frees a line walk
+ *
+ * @param walk Pointer to the walk to destroy
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_line_walk(LineWalk* walk);
+
+/**
+ * @brief Returns the number of pixels a sampled line can hold at most
+ *
+ * @param walk Line walk
+ *
+ * @return Size to allocate for the output of sample_line_walk()
+ */
+size_t line_walk_capacity(const LineWalk* walk);
+
+/**
+ * @brief Finds the center of a line of the walk's angle
+ *
+ * Lines of one angle are told apart by their signed distance from the
+ * image center, measured perpendicularly to them (downwards for rows).
+ * The center is the foot of that perpendicular; when it falls outside
+ * the image, the line is clipped and the point where it enters the image
+ * is returned instead, so oblique lines still reach the corners.
+ *
+ * @param[in]  walk   Line walk
+ * @param[in]  offset Distance from the image center in pixels
+ * @param[out] px     Column of the line center
+ * @param[out] py     Row of the line center
+ * @param[out] pshift Steps along the walk from the foot of the
+ *                    perpendicular to (px, py), 0 when the foot is inside
+ *                    (may be NULL)
+ *
+ * @return `true` if the line crosses the image, `false` otherwise
+ */
+bool line_walk_center(const LineWalk* walk, int offset, int* px, int* py, int* pshift);
+
+/**
+ * @brief Samples the pixels of the line through a point
+ *
+ * The line is clipped to the image. Its two ends are found by binary
+ * search on the walk (both coordinates move monotonically), so the inner
+ * loop is a plain gather with no bounds checks.
+ *
+ * @param walk Line walk
+ * @param data Pixels of a single-channel image of the walk's size
+ * @param x Column of a point of the line, inside the image
+ * @param y Row of a point of the line, inside the image
+ * @param line Output of at least line_walk_capacity() pixels, in reading
+ *        order
+ * @param pcenter Index of the pixel (x, y) in `line` (may be NULL); as
+ *        line_walk_center() points, less their shift, lie on one
+ *        perpendicular, positions relative to it line up across the lines
+ *        of a walk
+ *
+ * @return Number of pixels written
+ */
+size_t sample_line_walk(const LineWalk* walk, const uint8_t* data, int x, int y, uint8_t* line, size_t* pcenter);
@@ -0,0 +1,72 @@
+/**
+ * @file locate.h
+ * @brief Localization of barcode candidates by gradient energy
+ *
+ * Most of a shelf photo is not barcode, yet binarization and scanning
+ * cost is proportional to the whole image. Localization splits the image
+ * in cells of `scale` x `scale` pixels (a 1/4 or 1/8 resolution map) and
+ * accumulates in each cell the horizontal and vertical gradient energy of
+ * a couple of its rows. A barcode is a patch where one direction strongly
+ * dominates the other (vertical bars only have horizontal gradients);
+ * text and texture have both. A 3x3 majority filter drops the scattered
+ * or thin dominant cells of text and box edges, a dilation joins the
+ * pieces of a barcode split by wide spaces, and the connected groups of
+ * cells are boxed into the regions decoding is restricted to (see
+ * scan_regions_ean8_parallel()).
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "image.h"
+
+/**
+ * @struct Region
+ * @brief Rectangle of an image likely to hold a barcode
+ */
+typedef struct {
+    /** @brief Left column in pixels */
+    int x;
+    /** @brief Top row in pixels */
+    int y;
+    /** @brief Width in pixels */
+    int width;
+    /** @brief Height in pixels */
+    int height;
+    /** @brief Reading direction, from the dominant gradient */
+    ImageOrientation orientation;
+    /** @brief Mean excess of the dominant gradient over the other one per
+     *         cell, used to rank regions */
+    uint64_t energy;
+} Region;
+
+/**
+ * @brief Proposes the regions of an image that may hold a barcode
+ *
+ * @param[in]  gray     Grayscale image (single channel)
+ * @param[in]  scale    Cell size in pixels, e.g. 4 or 8
+ * @param[out] regions  Output array, sorted by decreasing energy
+ * @param[in]  capacity Maximum number of regions to return
+ *
+ * @return Number of regions written (0 if none or on invalid input or
+ *         memory allocation failure)
+ *
+ * @note The energy map is allocated on the heap and freed before returning
+ */
+size_t locate_regions(const Image* gray, int scale, Region* regions, size_t capacity);
+
+/**
+ * @brief locate_regions() with its scratch memory taken from a context
+ *
+ * @param[in]  context  Context providing the scratch memory (rewound
+ *                      before returning)
+ * @param[in]  gray     Grayscale image (single channel)
+ * @param[in]  scale    Cell size in pixels, e.g. 4 or 8
+ * @param[out] regions  Output array, sorted by decreasing energy
+ * @param[in]  capacity Maximum number of regions to return
+ *
+ * @return Number of regions written
+ */
+size_t locate_regions_ctx(LineVisionContext* context, const Image* gray, int scale, Region* regions, size_t capacity);
@@ -0,0 +1,72 @@
+/**
+ * @file pyramid.h
+ * @brief Box-filtered image pyramids
+ *
+ * Level 0 of a pyramid is the source grayscale image, and each further
+ * level halves the previous one with a 2x2 box filter (see
+ * downsample_2x_u8()): 1/2, 1/4, 1/8 of the width and height. A barcode
+ * whose modules are 8 px wide in a phone photo still has 2 px modules at
+ * 1/4 scale, so it can be decoded from 1/16 of the pixels.
+ */
+#pragma once
+
+#include "context.h"
+#include "image.h"
+
+/** @brief Maximum number of levels, the source image included */
+#define PYRAMID_MAX_LEVELS 4
+
+/**
+ * @struct ImagePyramid
+ * @brief Successive halvings of a grayscale image
+ */
+typedef struct {
+    /** @brief Number of valid levels, at least 1 */
+    int n_levels;
+    /** @brief Level i is 2^i times smaller than level 0 on each side;
+     *  level 0 shares the pixels of the source image */
+    Image levels[PYRAMID_MAX_LEVELS];
+    /** @brief Pixels of levels 1 and above, in one block */
+    unsigned char* data;
+} ImagePyramid;
+
+/**
+ * @brief Builds the pyramid of a grayscale image
+ *
+ * @param gray Grayscale image (single channel), must outlive the pyramid
+ * @param n_levels Number of levels wanted, source included, in
+ *                 [1, PYRAMID_MAX_LEVELS]; fewer are built when a level
+ *                 would be less than 1 pixel wide or high
+ *
+ * @return Pointer to a dynamically allocated ImagePyramid, or NULL on
+ *         invalid input or memory allocation failure
+ *
+ * @note Allocated memory must be freed with destroy_image_pyramid()
+ */
+ImagePyramid* create_image_pyramid(const Image* gray, int n_levels);
+
+/**
+ * @brief Builds the pyramid of a grayscale image in memory from a context
+ *
+ * @param context Context providing the memory
+ * @param gray Grayscale image (single channel), must outlive the pyramid
+ * @param n_levels Number of levels wanted, source included, in
+ *                 [1, PYRAMID_MAX_LEVELS]
+ *
+ * @return Pointer to an ImagePyramid living in the context, or NULL on
+ *         invalid input or allocation failure
+ *
+ * @note Must not be passed to destroy_image_pyramid(); the memory is
+ *       released by reset_linevision_context()
+ */
+ImagePyramid* create_image_pyramid_ctx(LineVisionContext* context, const Image* gray, int n_levels);
+
+/**
+ * @brief Frees the memory allocated for a pyramid
+ *
+ * @param pyramid Pointer to the pyramid to destroy (the source image is
+ *                not freed)
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_image_pyramid(ImagePyramid* pyramid);
@@ -0,0 +1,503 @@
+/**
+ * @file scan.h
+ * @brief Scanline scheduling over a whole image
+ *
+ * Decoding a single row only finds barcodes crossing that row. The
+ * scheduler visits several rows of a binarized image in a configurable
+ * order and stops at the first row that decodes with a valid check digit,
+ * or once enough rows agree on the same digits. A row budget bounds the
+ * work done on images without a readable barcode.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitplane.h"
+#include "context.h"
+#include "ean_errors.h"
+#include "ean_patterns.h"
+#include "image.h"
+#include "line_walk.h"
+#include "locate.h"
+#include "pyramid.h"
+
+/** @brief Sampling step of the global threshold histogram of decode_image_ean8():
+ *  one pixel every 8 columns of one row every 8 */
+#define THRESHOLD_SAMPLING_STEP 8
+
+/**
+ * @enum ScanOrder
+ * @brief Order in which the rows of an image are visited
+ */
+typedef enum {
+    /** @brief Middle row first, then alternately above and below it */
+    SCAN_ORDER_CENTER_OUT = 0,
+    /** @brief From the first row to the last */
+    SCAN_ORDER_TOP_DOWN = 1,
+    /** @brief From the last row to the first */
+    SCAN_ORDER_BOTTOM_UP = 2
+} ScanOrder;
+
+/**
+ * @enum ScanEngine
+ * @brief How the visited rows of a bit plane are decoded
+ */
+typedef enum {
+    /** @brief One row at a time, from its runs */
+    SCAN_ENGINE_ROWS = 0,
+    /** @brief Bands of 64 rows at once (see decode_band_ean8()); the
+     *  schedule then orders bands instead of rows */
+    SCAN_ENGINE_BITSLICED = 1
+} ScanEngine;
+
+/**
+ * @struct ScanOptions
+ * @brief Parameters of the scanline scheduler
+ */
+typedef struct {
+    /** @brief Order in which rows are visited */
+    ScanOrder order;
+    /** @brief Distance in pixels between two visited rows (at least 1) */
+    size_t row_step;
+    /** @brief Maximum number of rows decoded per image (0 = no limit) */
+    size_t max_rows;
+    /** @brief Number of rows that must agree on the same checksum-valid
+     *  digits before stopping (1 = first valid row wins) */
+    size_t votes;
+    /** @brief Decoding engine for bit plane scans; other scans always
+     *  decode row by row */
+    ScanEngine engine;
+} ScanOptions;
+
+/**
+ * @brief Fills scan options with the defaults
+ *
+ * Center-out order, every row, no row budget, first valid row wins,
+ * row-by-row engine.
+ *
+ * @param options Options to initialize
+ */
+void default_scan_options(ScanOptions* options);
+
+/**
+ * @brief Returns the row visited at a given step of the schedule
+ *
+ * @param options Scan options (order and row step)
+ * @param height Image height in pixels
+ * @param index Position in the schedule (0 = first visited row)
+ *
+ * @return Row index, or -1 if the schedule is over. Center-out schedules
+ *         may also return -2 for a position that falls outside the image
+ *         on one side only; such positions are skipped and do not count
+ *         toward the row budget.
+ */
+int scan_schedule_row(const ScanOptions* options, int height, size_t index);
+
+/**
+ * @brief Decodes one binarized pixel row
+ *
+ * Builds the scanline, estimates the module width, searches the EAN-8
+ * structure and decodes it, with all scratch memory taken from the
+ * context (and released before returning).
+ *
+ * @param[in]  context Context providing the scratch memory
+ * @param[in]  row     Binarized pixel row (0 = black, 255 = white)
+ * @param[in]  width   Number of pixels in the row
+ * @param[out] result  Caller-owned result; `status` is always set
+ *
+ * @return The value stored in `result->status` (see decode_segment_ean8()),
+ *         EAN8_ERROR_INVALID_FORMAT if the row holds no EAN-8 structure,
+ *         EAN8_ERROR_MEMORY_ALLOCATION if the context is exhausted
+ */
+EAN8Error decode_row_ean8(LineVisionContext* context, const uint8_t* row, size_t width, EAN8Result* result);
+
+/**
+ * @brief Decodes one row of a bit plane
+ *
+ * Same as decode_row_ean8(), with the runs extracted a word at a time
+ * from the packed row (see build_scanline_bits()).
+ *
+ * @param[in]  context Context providing the scratch memory
+ * @param[in]  bits    Packed row (1 = black)
+ * @param[in]  width   Number of pixels in the row
+ * @param[out] result  Caller-owned result; `status` is always set
+ *
+ * @return Same values as decode_row_ean8()
+ */
+EAN8Error decode_row_bits_ean8(LineVisionContext* context, const uint64_t* bits, size_t width, EAN8Result* result);
+
+/**
+ * @brief Thresholds and decodes one grayscale row
+ *
+ * Binarizes only this row into a packed bit row taken from the context
+ * (see threshold_pack_u8()), then decodes it with decode_row_bits_ean8().
+ *
+ * @param[in]  context   Context providing the scratch memory
+ * @param[in]  row       Grayscale pixel row
+ * @param[in]  width     Number of pixels in the row
+ * @param[in]  threshold Global threshold, e.g. from otsu_threshold_subsampled()
+ * @param[out] result    Caller-owned result; `status` is always set
+ *
+ * @return Same values as decode_row_ean8()
+ */
+EAN8Error decode_row_gray_ean8(LineVisionContext* context, const uint8_t* row, size_t width, int threshold, EAN8Result* result);
+
+/**
+ * @brief Scans the rows of a binarized image for an EAN-8 barcode
+ *
+ * Rows are visited following scan_schedule_row() until one of them
+ * decodes with a valid check digit (or `options->votes` rows agree on the
+ * same digits), or until the row budget is spent. When the budget runs
+ * out, the checksum-valid digits with the most votes are returned, if any.
+ *
+ * Rows that fail on the checksum or on some characters still vote for
+ * the digits they read (see DigitConsensus); when every position has a
+ * majority of at least 2 votes (or `options->votes`) and the check digit
+ * validates, that consensus is accepted as if its last row had decoded.
+ *
+ * @param[in]  context Context providing the scratch memory
+ * @param[in]  image   Binarized grayscale image (see binarization())
+ * @param[in]  options Scan options, or NULL for the defaults
+ * @param[out] result  Caller-owned result; `status` is always set
+ * @param[out] prow    Row the result was read from (may be NULL); -1 if
+ *                     no row decoded
+ *
+ * @return The value stored in `result->status`: EAN8_ERROR_NONE on
+ *         success, otherwise the error of the row that got furthest
+ *         (checksum, then decode, then format errors)
+ */
+EAN8Error scan_image_ean8(LineVisionContext* context, const Image* image, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Scans the rows of a binarized image on several threads
+ *
+ * Same schedule and result as scan_image_ean8(), with the rows handed out
+ * in schedule order to `n_workers` threads (the calling thread being one
+ * of them). As soon as a row is accepted, workers stop picking rows that
+ * come later in the schedule, so only rows with a higher priority are
+ * still finished; the accepted result is the earliest one in the schedule.
+ *
+ * @param[in]  contexts  One context per worker (not shared between threads)
+ * @param[in]  n_workers Number of workers, at least 1
+ * @param[in]  image     Binarized grayscale image (see binarization())
+ * @param[in]  options   Scan options, or NULL for the defaults
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] prow      Row the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8())
+ *
+ * @note If a thread cannot be started, the scan continues with fewer workers
+ */
+EAN8Error scan_image_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* image, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Scans the rows of a bit plane for an EAN-8 barcode
+ *
+ * Same as scan_image_ean8(), on an image binarized with
+ * binarize_bitplane(), so that the grayscale image stays available.
+ *
+ * @param[in]  context Context providing the scratch memory
+ * @param[in]  plane   Binarized image
+ * @param[in]  options Scan options, or NULL for the defaults
+ * @param[out] result  Caller-owned result; `status` is always set
+ * @param[out] prow    Row the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8())
+ */
+EAN8Error scan_bitplane_ean8(LineVisionContext* context, const BitPlane* plane, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Scans the rows of a bit plane on several threads
+ *
+ * Same as scan_image_ean8_parallel() on a bit plane.
+ *
+ * @param[in]  contexts  One context per worker (not shared between threads)
+ * @param[in]  n_workers Number of workers, at least 1
+ * @param[in]  plane     Binarized image
+ * @param[in]  options   Scan options, or NULL for the defaults
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] prow      Row the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8())
+ */
+EAN8Error scan_bitplane_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const BitPlane* plane, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Scans a grayscale image, binarizing only the visited rows
+ *
+ * Lazy pipeline mode: the image is not binarized as a whole; each row
+ * picked by the scheduler is thresholded when it is visited (see
+ * decode_row_gray_ean8()). Combined with otsu_threshold_subsampled(), an
+ * image whose first scheduled row decodes costs one row of thresholding
+ * instead of a full pass.
+ *
+ * @param[in]  context   Context providing the scratch memory
+ * @param[in]  gray      Grayscale image (single channel), left untouched
+ * @param[in]  threshold Global threshold
+ * @param[in]  options   Scan options, or NULL for the defaults
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] prow      Row the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8())
+ */
+EAN8Error scan_gray_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Lazy-binarization scan on several threads
+ *
+ * Same as scan_gray_ean8(), with the rows spread over workers as in
+ * scan_image_ean8_parallel().
+ *
+ * @param[in]  contexts  One context per worker (not shared between threads)
+ * @param[in]  n_workers Number of workers, at least 1
+ * @param[in]  gray      Grayscale image (single channel), left untouched
+ * @param[in]  threshold Global threshold
+ * @param[in]  options   Scan options, or NULL for the defaults
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] prow      Row the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8())
+ */
+EAN8Error scan_gray_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Scans a grayscale image binarized with the given options
+ *
+ * The whole image is binarized once into a bit plane allocated from
+ * `contexts[0]`, as is its scratch memory (see
+ * binarize_bitplane_with_options_ctx()), then scanned as
+ * in scan_bitplane_ean8_parallel(). Meant as the fallback when the lazy
+ * global-threshold scan fails on unevenly lit images, with
+ * BINARIZATION_ADAPTIVE.
+ *
+ * @param[in]  contexts     One context per worker (not shared between threads)
+ * @param[in]  n_workers    Number of workers, at least 1
+ * @param[in]  gray         Grayscale image (single channel), left untouched
+ * @param[in]  binarization Binarization options, or NULL for the defaults
+ * @param[in]  options      Scan options, or NULL for the defaults
+ * @param[out] result       Caller-owned result; `status` is always set
+ * @param[out] prow         Row the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8()),
+ *         EAN8_ERROR_MEMORY_ALLOCATION if the plane cannot be allocated
+ */
+EAN8Error scan_binarized_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, const BinarizationOptions* binarization, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Single-threaded scan_binarized_ean8_parallel()
+ */
+EAN8Error scan_binarized_ean8(LineVisionContext* context, const Image* gray, const BinarizationOptions* binarization, const ScanOptions* options, EAN8Result* result, int* prow);
+
+/**
+ * @brief Scans a grayscale image along lines at several angles
+ *
+ * Lines are sampled at 0, +step, -step, +2 step... degrees within
+ * (-90, 90] through precomputed walks (see line_walk.h) allocated from
+ * `contexts[0]`, thresholded and decoded like rows. All angles are tried
+ * at one distance from the image center before moving outwards by
+ * `options->row_step` pixels, so a tilted barcode near the center is
+ * found after a handful of lines. The row budget and votes of the
+ * options count lines; the bit-sliced engine does not apply.
+ *
+ * @param[in]  contexts   One context per worker (not shared between threads)
+ * @param[in]  n_workers  Number of workers, at least 1
+ * @param[in]  gray       Grayscale image (single channel), left untouched
+ * @param[in]  threshold  Global threshold
+ * @param[in]  options    Scan options, or NULL for the defaults
+ * @param[in]  angle_step Degrees between two scan angles, in [1, 90]
+ *                        (e.g. 15)
+ * @param[out] result     Caller-owned result; `status` is always set
+ * @param[out] pline      Line the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8()),
+ *         EAN8_ERROR_INVALID_INPUT for an angle step out of range
+ */
+EAN8Error scan_angles_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, int angle_step, EAN8Result* result, LinePosition* pline);
+
+/**
+ * @brief Single-threaded scan_angles_ean8_parallel()
+ */
+EAN8Error scan_angles_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, int angle_step, EAN8Result* result, LinePosition* pline);
+
+/**
+ * @brief Scans the columns of a grayscale image, for barcodes rotated 90°
+ *
+ * The image is transposed into memory taken from `contexts[0]` with the
+ * cache-blocked transpose_u8() kernel, then its rows are scanned lazily
+ * as in scan_gray_ean8_parallel(). Barcodes that read from bottom to top
+ * decode in the same pass, as the row decoders read either direction.
+ *
+ * @param[in]  contexts  One context per worker (not shared between threads)
+ * @param[in]  n_workers Number of workers, at least 1
+ * @param[in]  gray      Grayscale image (single channel), left untouched
+ * @param[in]  threshold Global threshold
+ * @param[in]  options   Scan options, or NULL for the defaults; the
+ *                       schedule and row step apply to columns
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] pcolumn   Column the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8()),
+ *         EAN8_ERROR_MEMORY_ALLOCATION if the transposed image cannot be
+ *         allocated
+ */
+EAN8Error scan_vertical_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* pcolumn);
+
+/**
+ * @brief Single-threaded scan_vertical_ean8_parallel()
+ */
+EAN8Error scan_vertical_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* pcolumn);
+
+/**
+ * @brief Scans only the given regions of a grayscale image
+ *
+ * Each region, typically proposed by locate_regions(), is copied into
+ * memory taken from `contexts[0]` (transposed with transpose_u8() when it
+ * is vertical), thresholded with its own Otsu threshold and scanned lazily
+ * as in scan_gray_ean8_parallel(), which reads barcodes in either
+ * direction. Regions are tried in order until one decodes, so
+ * binarization and scanning never touch the rest of the image.
+ *
+ * @param[in]  contexts  One context per worker (not shared between threads)
+ * @param[in]  n_workers Number of workers, at least 1
+ * @param[in]  gray      Grayscale image (single channel), left untouched
+ * @param[in]  regions   Regions to scan, in order of preference; regions
+ *                       not inside the image are skipped
+ * @param[in]  n_regions Number of regions
+ * @param[in]  options   Scan options, or NULL for the defaults
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] pline     Line the result was read from in image
+ *                       coordinates: center of the row (angle 0) or of
+ *                       the column (angle 90) (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8()),
+ *         EAN8_ERROR_INVALID_FORMAT when there is no region to scan
+ */
+EAN8Error scan_regions_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, const Region* regions, size_t n_regions, const ScanOptions* options, EAN8Result* result, LinePosition* pline);
+
+/**
+ * @brief Single-threaded scan_regions_ean8_parallel()
+ */
+EAN8Error scan_regions_ean8(LineVisionContext* context, const Image* gray, const Region* regions, size_t n_regions, const ScanOptions* options, EAN8Result* result, LinePosition* pline);
+
+/**
+ * @brief Estimates the module width of the barcodes of an image
+ *
+ * Thresholds `samples` evenly spaced lines along the reading direction
+ * and collects the module width of every window whose guards are
+ * consistent (see find_module_fixed_scanline()). The median is returned,
+ * so a few windows that only look like guards do not matter.
+ *
+ * @param context     Context providing the scratch memory (rewound before
+ *                    returning)
+ * @param gray        Grayscale image (single channel)
+ * @param threshold   Global threshold
+ * @param orientation Reading direction: rows or columns are sampled
+ * @param samples     Number of lines to sample (at least 1)
+ *
+ * @return Module width in pixels with MODULE_FIXED_SHIFT fractional bits,
+ *         or 0 on invalid input or if no sampled line crosses a barcode
+ */
+uint32_t estimate_module_fixed(LineVisionContext* context, const Image* gray, int threshold, ImageOrientation orientation, int samples);
+
+/**
+ * @brief Scans a pyramid from coarse to fine
+ *
+ * The module width is estimated on level 0 (see estimate_module_fixed()),
+ * and the scan starts on the coarsest level where it is still at least
+ * 1.5 px wide, or on the coarsest level when no estimate is found. The
+ * level is scanned as in scan_gray_ean8_parallel() (or
+ * scan_vertical_ean8_parallel() for vertical barcodes), and finer levels
+ * are only scanned when it does not decode. Box filtering keeps the mean
+ * gray level, so the threshold of level 0 serves all levels.
+ *
+ * @param[in]  contexts    One context per worker (not shared between threads)
+ * @param[in]  n_workers   Number of workers, at least 1
+ * @param[in]  pyramid     Pyramid of the grayscale image
+ * @param[in]  threshold   Global threshold of level 0
+ * @param[in]  orientation Reading direction (see detect_orientation())
+ * @param[in]  options     Scan options, or NULL for the defaults
+ * @param[out] result      Caller-owned result; `status` is always set
+ * @param[out] pline       Row (or column, for vertical barcodes) the
+ *                         result was read from, in level 0 pixels (may
+ *                         be NULL)
+ * @param[out] plevel      Level the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8())
+ */
+EAN8Error scan_pyramid_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const ImagePyramid* pyramid, int threshold, ImageOrientation orientation, const ScanOptions* options, EAN8Result* result, int* pline, int* plevel);
+
+/**
+ * @brief Single-threaded scan_pyramid_ean8_parallel()
+ */
+EAN8Error scan_pyramid_ean8(LineVisionContext* context, const ImagePyramid* pyramid, int threshold, ImageOrientation orientation, const ScanOptions* options, EAN8Result* result, int* pline, int* plevel);
+
+/**
+ * @enum DecodeStage
+ * @brief Stage of decode_image_ean8() that decoded an image
+ */
+typedef enum {
+    /** @brief No stage decoded the image */
+    DECODE_STAGE_NONE = 0,
+    /** @brief A pyramid level (large images only) */
+    DECODE_STAGE_PYRAMID,
+    /** @brief A region located by gradient energy */
+    DECODE_STAGE_REGION,
+    /** @brief The whole image, by rows or by columns */
+    DECODE_STAGE_IMAGE,
+    /** @brief The whole image with an adaptive threshold */
+    DECODE_STAGE_ADAPTIVE,
+    /** @brief An angled line */
+    DECODE_STAGE_ANGLE
+} DecodeStage;
+
+/**
+ * @struct DecodeReport
+ * @brief How decode_image_ean8() read an image
+ */
+typedef struct {
+    /** @brief Stage the result was read by */
+    DecodeStage stage;
+    /** @brief Global threshold (given, or from otsu_threshold_subsampled()) */
+    int threshold;
+    /** @brief Reading direction (see detect_orientation()) */
+    ImageOrientation orientation;
+    /** @brief Row the result was read from, -1 if none */
+    int row;
+    /** @brief Column the result was read from, -1 if none */
+    int column;
+    /** @brief Pyramid level, for DECODE_STAGE_PYRAMID */
+    int level;
+    /** @brief Number of located regions, for DECODE_STAGE_REGION */
+    size_t n_regions;
+    /** @brief Angle of the line in degrees, for DECODE_STAGE_ANGLE */
+    int angle;
+} DecodeReport;
+
+/**
+ * @brief Decodes an image through every scan, cheapest first
+ *
+ * The image is thresholded once, then scanned until a stage decodes:
+ *
+ * 1. the regions with barcode-like gradients (scan_regions_ean8_parallel()),
+ * 2. the whole image: through its pyramid from 4 Mpx up
+ *    (scan_pyramid_ean8_parallel()), by rows or by columns below,
+ * 3. the whole image with an adaptive threshold, for uneven lighting,
+ *    along the rows or the columns as well,
+ * 4. angled lines 15 degrees apart, for tilted barcodes.
+ *
+ * @param[in]  contexts  One context per worker (not shared between threads);
+ *                       the first one is rewound before returning
+ * @param[in]  n_workers Number of workers, at least 1
+ * @param[in]  gray      Grayscale image (single channel)
+ * @param[in]  threshold Global threshold, e.g. from rgb_to_grayscale_otsu(),
+ *                       or -1 to compute it with otsu_threshold_subsampled()
+ * @param[in]  options   Scan options, or NULL for the defaults
+ * @param[out] result    Caller-owned result; `status` is always set
+ * @param[out] report    Stage and line the result was read from (may be NULL)
+ *
+ * @return The value stored in `result->status` (see scan_image_ean8()),
+ *         EAN8_ERROR_INVALID_INPUT on NULL pointers or when `gray` is not
+ *         a grayscale image
+ */
+EAN8Error decode_image_ean8(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, DecodeReport* report);
@@ -0,0 +1,140 @@
+/**
+ * @file scanline.h
+ * @brief Run-length encoded scanlines
+ *
+ * A scanline stores one binarized pixel row as a sequence of runs of the
+ * same color. It is built once per row and then shared by every decoding
+ * stage (module estimation, guard search, digit decoding), so that each
+ * stage works in O(number of edges) instead of O(number of pixels).
+ *
+ * Colors follow the barcode convention used by SegmentEAN:
+ * - 1 represents a bar (black pixel)
+ * - 0 represents a space (white pixel)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "context.h"
+
+/**
+ * @struct Run
+ * @brief A maximal sequence of pixels of the same color
+ */
+typedef struct {
+    /** @brief Color of the run (1 = bar, 0 = space) */
+    uint8_t color;
+    /** @brief Index of the first pixel of the run in the row */
+    size_t start;
+    /** @brief Number of pixels in the run */
+    size_t length;
+} Run;
+
+/**
+ * @struct Scanline
+ * @brief Run-length encoded representation of a binarized pixel row
+ */
+typedef struct {
+    /** @brief Runs, ordered from left to right */
+    Run* runs;
+    /** @brief Number of valid runs */
+    size_t count;
+    /** @brief Number of allocated runs */
+    size_t capacity;
+    /** @brief Length of the encoded row in pixels */
+    size_t width;
+    /** @brief Whether the run storage is heap-owned and may be grown */
+    bool growable;
+} Scanline;
+
+/**
+ * @brief Allocates an empty scanline
+ *
+ * @param capacity Initial number of runs to reserve (grown on demand)
+ *
+ * @return Pointer to a dynamically allocated Scanline, or NULL if memory
+ *         allocation fails
+ *
+ * @note Allocated memory must be freed with destroy_scanline()
+ * @note A scanline can be rebuilt for many rows; its storage is reused
+ */
+Scanline* create_scanline(size_t capacity);
+
+/**
+ * @brief Allocates an empty scanline from a context
+ *
+ * Run storage is sized for the worst case of `width` runs, so rows of up
+ * to `width` pixels never need to grow it.
+ *
+ * @param context Context providing the memory
+ * @param width Maximum length of the rows that will be encoded
+ *
+ * @return Pointer to a Scanline living in the context, or NULL if the
+ *         context allocation fails
+ *
+ * @note Must not be passed to destroy_scanline(); the memory is released
+ *       by reset_linevision_context()
+ */
+Scanline* create_scanline_ctx(LineVisionContext* context, size_t width);
+
+/**
+ * @brief Frees the memory allocated for a scanline
+ *
+ * @param scanline Pointer to the scanline to destroy
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_scanline(Scanline* scanline);
+
+/**
+ * @brief Encodes a binarized pixel row into runs
+ *
+ * @param scanline Scanline to fill (previous content is discarded)
+ * @param row Pointer to binarized pixels (0 = black, non-zero = white)
+ * @param length Number of pixels in the row
+ *
+ * @return `true` on success, `false` on invalid input or if growing the
+ *         run storage fails (or is needed on a context scanline)
+ */
+bool build_scanline(Scanline* scanline, const uint8_t* row, size_t length);
+
+/**
+ * @brief Encodes a packed bit row into runs
+ *
+ * Same result as build_scanline() for a row of a BitPlane (1 = black).
+ * Transitions are found a word at a time by XOR-ing each word with itself
+ * shifted by one bit, then enumerated with count-trailing-zeros, so the
+ * cost is proportional to the number of words plus the number of edges.
+ *
+ * @param scanline Scanline to fill (previous content is discarded)
+ * @param bits Packed row, bit `i % 64` of `bits[i / 64]` is pixel i
+ * @param length Number of pixels in the row
+ *
+ * @return `true` on success, `false` on invalid input or if growing the
+ *         run storage fails (or is needed on a context scanline)
+ */
+bool build_scanline_bits(Scanline* scanline, const uint64_t* bits, size_t length);
+
+/**
+ * @brief Finds the run covering a pixel
+ *
+ * Binary search over the runs, which are ordered and contiguous.
+ *
+ * @param scanline Run-length encoded row
+ * @param pixel Pixel index in the row
+ *
+ * @return Index of the run containing `pixel`, or `scanline->count` when
+ *         the pixel is past the last run
+ */
+size_t find_run_scanline(const Scanline* scanline, size_t pixel);
+
+/**
+ * @brief Prints the runs of a scanline to standard output
+ *
+ * Each run is printed as `<color>x<length>`, separated by spaces.
+ *
+ * @param scanline Pointer to the scanline to display
+ */
+void print_scanline(const Scanline* scanline);
@@ -0,0 +1,74 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing thread pool
+ *
+ * Each worker owns a task queue. Submitted tasks are spread over the
+ * queues; a worker takes its own tasks newest first and, when its queue
+ * is empty, steals the oldest task of another worker. Tasks receive the
+ * index of the worker running them, so per-worker resources (e.g. one
+ * LineVisionContext per worker) can be used without locking.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Task run by the pool
+ *
+ * @param arg Argument given to thread_pool_submit()
+ * @param worker Index of the worker running the task (0 to n_workers - 1)
+ */
+typedef void (*ThreadPoolTask)(void* arg, size_t worker);
+
+/** @brief Opaque thread pool */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Starts a thread pool
+ *
+ * @param n_workers Number of worker threads (at least 1)
+ *
+ * @return Pointer to a dynamically allocated pool, or NULL if memory
+ *         allocation or thread creation fails
+ *
+ * @note The pool must be freed with destroy_thread_pool()
+ */
+ThreadPool* create_thread_pool(size_t n_workers);
+
+/**
+ * @brief Queues a task
+ *
+ * @param pool Pool to run the task
+ * @param task Function to run
+ * @param arg Argument passed to the task
+ *
+ * @return `true` if the task was queued, `false` on invalid input or
+ *         memory allocation failure
+ */
+bool thread_pool_submit(ThreadPool* pool, ThreadPoolTask task, void* arg);
+
+/**
+ * @brief Waits until every submitted task has finished
+ *
+ * @param pool Pool to wait for
+ */
+void thread_pool_wait(ThreadPool* pool);
+
+/**
+ * @brief Returns the number of workers of a pool
+ *
+ * @param pool Pool to query
+ *
+ * @return Number of worker threads
+ */
+size_t thread_pool_workers(const ThreadPool* pool);
+
+/**
+ * @brief Finishes the queued tasks, stops the workers and frees the pool
+ *
+ * @param pool Pool to destroy
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_thread_pool(ThreadPool* pool);
@@ -0,0 +1,102 @@
+/**
+ * @file threshold_stream.h
+ * @brief Otsu threshold maintained incrementally over a stream of frames
+ *
+ * Consecutive camera frames share most of their pixels, yet
+ * otsu_threshold() rebuilds the histogram and reruns the 256-step search
+ * for each of them. A ThresholdStream keeps the histogram of a sparse grid
+ * of samples from one frame to the next: each frame only moves the
+ * samples whose value changed, and the search is rerun only once enough
+ * samples have changed to shift the distribution. The search itself uses
+ * integer arithmetic only.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * @struct ThresholdStream
+ * @brief State of the incremental threshold estimator
+ *
+ * `tolerance` and `refresh` may be tuned after create_threshold_stream().
+ */
+typedef struct {
+    /** @brief Frame width in pixels */
+    int width;
+    /** @brief Frame height in pixels */
+    int height;
+    /** @brief Distance between samples, in pixels, along both axes */
+    int step;
+    /** @brief Number of samples in the grid */
+    size_t count;
+    /** @brief Value counted in the histogram for each sample */
+    uint8_t* samples;
+    /** @brief Histogram of `samples` */
+    uint32_t histogram[256];
+    /** @brief Threshold from the last search */
+    int threshold;
+    /** @brief Samples moved in the histogram since the last search */
+    size_t changed;
+    /** @brief Whether the histogram has been filled by a first frame */
+    bool primed;
+    /** @brief A sample is updated only when it moves by more than this
+     *  many gray levels, so that sensor noise does not count as change */
+    int tolerance;
+    /** @brief Changed samples (per thousand of `count`) that trigger a
+     *  new search; below that, the previous threshold is reused */
+    int refresh;
+} ThresholdStream;
+
+/**
+ * @brief Allocates a threshold estimator for frames of a given size
+ *
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @param step Sampling step along both axes (e.g. 8 for 1/64 of the pixels)
+ *
+ * @return Pointer to a dynamically allocated ThresholdStream, or NULL on
+ *         invalid size or memory allocation failure
+ *
+ * @note Allocated memory must be freed with destroy_threshold_stream()
+ */
+ThresholdStream* create_threshold_stream(int width, int height, int step);
+
+/**
+ * @brief Frees a threshold estimator
+ *
+ * @param stream Pointer to the estimator to destroy
+ *
+ * @note This function is safe with a NULL pointer
+ */
+void destroy_threshold_stream(ThresholdStream* stream);
+
+/**
+ * @brief Forgets the histogram, e.g. after a scene cut
+ *
+ * The next call to threshold_stream_update() samples the whole grid and
+ * searches again.
+ *
+ * @param stream Estimator to reset
+ */
+void reset_threshold_stream(ThresholdStream* stream);
+
+/**
+ * @brief Updates the estimator with a new frame and returns its threshold
+ *
+ * The first frame fills the histogram from every sample. On later frames,
+ * each sample that moved by more than `tolerance` is moved from its old
+ * histogram bin to its new one; the Otsu search is rerun only when the
+ * samples changed since the last search exceed `refresh` per thousand,
+ * otherwise the previous threshold is returned as is.
+ *
+ * @param stream Estimator created for the size of `frame`
+ * @param frame Grayscale frame (single channel)
+ *
+ * @return The threshold (0-255), or -1 on invalid input or a frame whose
+ *         size differs from the estimator's
+ */
+int threshold_stream_update(ThresholdStream* stream, const Image* frame);
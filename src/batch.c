@@ -0,0 +1,266 @@
+#include "batch.h"
+#include "context.h"
+#include "image.h"
+#include "scan.h"
+#include "thread_pool.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+typedef struct {
+    const char* path;
+    EAN8Result result;
+    int row;
+    double milliseconds;
+    bool loaded;
+} BatchItem;
+
+typedef struct {
+    BatchItem* items;
+    LineVisionContext** contexts;
+    FILE* out;
+    pthread_mutex_t out_lock;
+} Batch;
+
+typedef struct {
+    Batch* batch;
+    BatchItem* item;
+} BatchTask;
+
+static int push_path(BatchPaths* paths, const char* path) {
+    if (paths->count == paths->capacity) {
+        size_t capacity = paths->capacity == 0 ? 64 : paths->capacity * 2;
+        char** grown = realloc(paths->paths, capacity * sizeof(char*));
+        if (!grown) return -1;
+
+        paths->paths = grown;
+        paths->capacity = capacity;
+    }
+
+    char* copy = strdup(path);
+    if (!copy) return -1;
+
+    paths->paths[paths->count++] = copy;
+    return 0;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int add_directory(BatchPaths* paths, const char* directory) {
+    DIR* dir = opendir(directory);
+    if (!dir) return -1;
+
+    size_t first = paths->count;
+    int status = 0;
+
+    struct dirent* entry;
+    while (status == 0 && (entry = readdir(dir))) {
+        size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+        char* path = malloc(length);
+        if (!path) {
+            status = -1;
+            break;
+        }
+        snprintf(path, length, "%s/%s", directory, entry->d_name);
+
+        struct stat info;
+        if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) status = push_path(paths, path);
+        free(path);
+    }
+
+    closedir(dir);
+
+    qsort(&paths->paths[first], paths->count - first, sizeof(char*), compare_paths);
+    return status;
+}
+
+static int add_stdin(BatchPaths* paths) {
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    int status = 0;
+
+    while (status == 0 && (length = getline(&line, &size, stdin)) != -1) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\0';
+        if (length > 0) status = push_path(paths, line);
+    }
+
+    free(line);
+    return status;
+}
+
+int add_batch_paths(BatchPaths* paths, const char* arg) {
+    if (!paths || !arg) return -1;
+
+    if (strcmp(arg, "-") == 0) return add_stdin(paths);
+
+    struct stat info;
+    if (stat(arg, &info) == 0 && S_ISDIR(info.st_mode)) return add_directory(paths, arg);
+
+    return push_path(paths, arg);
+}
+
+void clear_batch_paths(BatchPaths* paths) {
+    if (!paths) return;
+
+    for (size_t i = 0; i < paths->count; i++) free(paths->paths[i]);
+    free(paths->paths);
+
+    paths->paths = NULL;
+    paths->count = 0;
+    paths->capacity = 0;
+}
+
+static double now_milliseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+}
+
+static const char* status_token(const BatchItem* item) {
+    if (!item->loaded) return "load";
+
+    switch (item->result.status) {
+        case EAN8_ERROR_NONE: return item->result.recovered ? "recovered" : "ok";
+        case EAN8_ERROR_INVALID_CHECKSUM: return "checksum";
+        case EAN8_ERROR_INVALID_DECODE: return "decode";
+        case EAN8_ERROR_INVALID_FORMAT: return "format";
+        case EAN8_ERROR_INVALID_INPUT: return "input";
+        case EAN8_ERROR_MEMORY_ALLOCATION: return "memory";
+        default: return "unknown";
+    }
+}
+
+static void print_item(FILE* out, const BatchItem* item) {
+    char digits[EAN8_DIGIT_COUNT + 1] = "-";
+
+    if (item->loaded && (item->result.status == EAN8_ERROR_NONE || item->result.status == EAN8_ERROR_INVALID_CHECKSUM)) {
+        for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) digits[i] = (char)('0' + item->result.digits[i]);
+        digits[EAN8_DIGIT_COUNT] = '\0';
+    }
+
+    fprintf(out, "%s\t%s\t%s\t%d\t%.3f\n", item->path, status_token(item), digits, item->row, item->milliseconds);
+}
+
+static void decode_item(void* arg, size_t worker) {
+    BatchTask* task = arg;
+    Batch* batch = task->batch;
+    BatchItem* item = task->item;
+    LineVisionContext* context = batch->contexts[worker];
+
+    double start = now_milliseconds();
+
+    item->row = -1;
+    item->result.status = EAN8_ERROR_INVALID_INPUT;
+
+    Image* image = open_image(item->path, 0);
+    item->loaded = image != NULL;
+
+    if (image) {
+        int threshold = rgb_to_grayscale_otsu(image, THRESHOLD_SAMPLING_STEP);
+
+        DecodeReport report;
+        decode_image_ean8(&context, 1, image, threshold, NULL, &item->result, &report);
+        item->row = report.row >= 0 ? report.row : report.column;
+
+        reset_linevision_context(context);
+        close_image(image);
+    }
+
+    item->milliseconds = now_milliseconds() - start;
+
+    pthread_mutex_lock(&batch->out_lock);
+    print_item(batch->out, item);
+    pthread_mutex_unlock(&batch->out_lock);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of sorted values
+static double percentile(const double* sorted, size_t count, double p) {
+    if (count == 0) return 0.0;
+
+    size_t rank = (size_t)(p / 100.0 * count + 0.999999);
+    if (rank == 0) rank = 1;
+    if (rank > count) rank = count;
+
+    return sorted[rank - 1];
+}
+
+int run_batch(const BatchPaths* paths, size_t n_workers, FILE* out) {
+    if (!paths || !out || n_workers == 0) return -1;
+
+    size_t count = paths->count;
+
+    Batch batch;
+    batch.out = out;
+    batch.items = calloc(count + 1, sizeof(BatchItem));
+    batch.contexts = calloc(n_workers, sizeof(LineVisionContext*));
+    BatchTask* tasks = calloc(count + 1, sizeof(BatchTask));
+    double* latencies = calloc(count + 1, sizeof(double));
+
+    bool ok = batch.items && batch.contexts && tasks && latencies;
+    for (size_t i = 0; ok && i < n_workers; i++) {
+        batch.contexts[i] = create_linevision_context(0);
+        ok = batch.contexts[i] != NULL;
+    }
+
+    ThreadPool* pool = ok ? create_thread_pool(n_workers) : NULL;
+    int failures = -1;
+
+    if (pool) {
+        pthread_mutex_init(&batch.out_lock, NULL);
+        double start = now_milliseconds();
+
+        failures = 0;
+        size_t submitted = 0;
+        for (; submitted < count; submitted++) {
+            batch.items[submitted].path = paths->paths[submitted];
+            tasks[submitted].batch = &batch;
+            tasks[submitted].item = &batch.items[submitted];
+
+            if (!thread_pool_submit(pool, decode_item, &tasks[submitted])) break;
+        }
+
+        thread_pool_wait(pool);
+
+        // queue could not grow: decode the rest here rather than dropping images
+        for (size_t i = submitted; i < count; i++) {
+            batch.items[i].path = paths->paths[i];
+            tasks[i].batch = &batch;
+            tasks[i].item = &batch.items[i];
+            decode_item(&tasks[i], 0);
+        }
+        double elapsed = now_milliseconds() - start;
+
+        for (size_t i = 0; i < count; i++) {
+            latencies[i] = batch.items[i].milliseconds;
+            if (!batch.items[i].loaded || batch.items[i].result.status != EAN8_ERROR_NONE) failures++;
+        }
+        qsort(latencies, count, sizeof(double), compare_doubles);
+
+        fprintf(stderr, "images: %zu, decoded: %zu, workers: %zu\n", count, count - failures, n_workers);
+        fprintf(stderr, "elapsed: %.3f ms, throughput: %.1f images/s\n", elapsed, elapsed > 0 ? count * 1000.0 / elapsed : 0.0);
+        fprintf(stderr, "latency p50: %.3f ms, p99: %.3f ms\n", percentile(latencies, count, 50), percentile(latencies, count, 99));
+
+        pthread_mutex_destroy(&batch.out_lock);
+    }
+
+    destroy_thread_pool(pool);
+    for (size_t i = 0; batch.contexts && i < n_workers; i++) destroy_linevision_context(batch.contexts[i]);
+
+    free(latencies);
+    free(tasks);
+    free(batch.contexts);
+    free(batch.items);
+
+    return failures;
+}
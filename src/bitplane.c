@@ -0,0 +1,193 @@
+#include "bitplane.h"
+#include "image_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// rows padded to whole words, plus two words read past the end by packed searches
+static size_t bitplane_words(int width, int height, size_t* stride) {
+    *stride = ((size_t)width + 63) / 64;
+    return *stride * height + 2;
+}
+
+static void init_bitplane(BitPlane* plane, uint64_t* bits, int width, int height, size_t stride, size_t n_words) {
+    plane->width = width;
+    plane->height = height;
+    plane->stride = stride;
+    plane->bits = bits;
+
+    memset(bits, 0, n_words * sizeof(uint64_t));
+}
+
+BitPlane* create_bitplane(int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    BitPlane* plane = malloc(sizeof(BitPlane));
+    if (!plane) return NULL;
+
+    size_t stride;
+    size_t n_words = bitplane_words(width, height, &stride);
+
+    uint64_t* bits = malloc(n_words * sizeof(uint64_t));
+    if (!bits) {
+        free(plane);
+        return NULL;
+    }
+
+    init_bitplane(plane, bits, width, height, stride, n_words);
+    return plane;
+}
+
+BitPlane* create_bitplane_ctx(LineVisionContext* context, int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    BitPlane* plane = linevision_context_alloc(context, sizeof(BitPlane));
+    if (!plane) return NULL;
+
+    size_t stride;
+    size_t n_words = bitplane_words(width, height, &stride);
+
+    uint64_t* bits = linevision_context_alloc(context, n_words * sizeof(uint64_t));
+    if (!bits) return NULL;
+
+    init_bitplane(plane, bits, width, height, stride, n_words);
+    return plane;
+}
+
+void destroy_bitplane(BitPlane* plane) {
+    if (!plane) return;
+    free(plane->bits);
+    free(plane);
+}
+
+bool binarize_bitplane(const Image* image, int threshold, BitPlane* plane) {
+    if (!image || !image->data || !plane) return false;
+
+    if (image->channels != 1) {
+        fprintf(stderr, "binarize_bitplane: image must be grayscale\n");
+        return false;
+    }
+
+    if (image->width != plane->width || image->height != plane->height) return false;
+
+    for (int y = 0; y < image->height; y++) {
+        const uint8_t* row = &image->data[(size_t)y * image->width];
+        threshold_pack_u8(row, image->width, threshold, &plane->bits[(size_t)y * plane->stride]);
+    }
+
+    return true;
+}
+
+// columns holds width counters, prefix width + 1
+static void binarize_bitplane_adaptive(const Image* image, int window, int sensitivity, uint32_t* columns, uint64_t* prefix, BitPlane* plane) {
+    int width = image->width;
+    int height = image->height;
+
+    if (window <= 0) window = width / 8;
+    if (window < 3) window = 3;
+    int radius = window / 2;
+
+    // column sums over the rows of the window, and their prefix sum along the row
+    memset(columns, 0, width * sizeof(uint32_t));
+
+    for (int y = 0; y <= radius && y < height; y++) {
+        const uint8_t* row = &image->data[(size_t)y * width];
+        for (int x = 0; x < width; x++) columns[x] += row[x];
+    }
+
+    uint64_t keep = 100 - sensitivity;
+
+    for (int y = 0; y < height; y++) {
+        int y0 = y - radius < 0 ? 0 : y - radius;
+        int y1 = y + radius >= height ? height - 1 : y + radius;
+        uint64_t rows = (uint64_t)(y1 - y0 + 1);
+
+        prefix[0] = 0;
+        for (int x = 0; x < width; x++) prefix[x + 1] = prefix[x] + columns[x];
+
+        const uint8_t* row = &image->data[(size_t)y * width];
+        uint64_t* bits = &plane->bits[(size_t)y * plane->stride];
+        memset(bits, 0, plane->stride * sizeof(uint64_t));
+
+        for (int x = 0; x < width; x++) {
+            int x0 = x - radius < 0 ? 0 : x - radius;
+            int x1 = x + radius >= width ? width - 1 : x + radius;
+
+            uint64_t area = rows * (uint64_t)(x1 - x0 + 1);
+            uint64_t sum = prefix[x1 + 1] - prefix[x0];
+
+            if ((uint64_t)row[x] * area * 100 <= sum * keep) {
+                bits[x >> 6] |= UINT64_C(1) << (x & 63);
+            }
+        }
+
+        // slide the window down one row
+        if (y + radius + 1 < height) {
+            const uint8_t* entering = &image->data[(size_t)(y + radius + 1) * width];
+            for (int x = 0; x < width; x++) columns[x] += entering[x];
+        }
+        if (y - radius >= 0) {
+            const uint8_t* leaving = &image->data[(size_t)(y - radius) * width];
+            for (int x = 0; x < width; x++) columns[x] -= leaving[x];
+        }
+    }
+}
+
+// scratch of the adaptive method from the context, or from the heap without one
+static bool binarize_bitplane_options(LineVisionContext* context, const Image* image, const BinarizationOptions* options, BitPlane* plane) {
+    if (!image || !image->data || !plane) return false;
+
+    if (image->channels != 1) {
+        fprintf(stderr, "binarize_bitplane_with_options: image must be grayscale\n");
+        return false;
+    }
+
+    if (image->width != plane->width || image->height != plane->height) return false;
+
+    BinarizationOptions defaults;
+    if (!options) {
+        default_binarization_options(&defaults);
+        options = &defaults;
+    }
+
+    if (options->method == BINARIZATION_ADAPTIVE) {
+        int sensitivity = options->sensitivity < 0 ? 0 : options->sensitivity > 100 ? 100 : options->sensitivity;
+        size_t columns_size = (size_t)image->width * sizeof(uint32_t);
+        size_t prefix_size = ((size_t)image->width + 1) * sizeof(uint64_t);
+
+        if (context) {
+            size_t mark = linevision_context_mark(context);
+            uint32_t* columns = linevision_context_alloc(context, columns_size);
+            uint64_t* prefix = linevision_context_alloc(context, prefix_size);
+
+            bool ok = columns && prefix;
+            if (ok) binarize_bitplane_adaptive(image, options->window, sensitivity, columns, prefix, plane);
+
+            rewind_linevision_context(context, mark);
+            return ok;
+        }
+
+        uint32_t* columns = malloc(columns_size);
+        uint64_t* prefix = malloc(prefix_size);
+
+        bool ok = columns && prefix;
+        if (ok) binarize_bitplane_adaptive(image, options->window, sensitivity, columns, prefix, plane);
+
+        free(columns);
+        free(prefix);
+        return ok;
+    }
+
+    int threshold = options->threshold;
+    if (threshold < 0) threshold = otsu_threshold(image->data, image->width * image->height);
+
+    return binarize_bitplane(image, threshold, plane);
+}
+
+bool binarize_bitplane_with_options(const Image* image, const BinarizationOptions* options, BitPlane* plane) {
+    return binarize_bitplane_options(NULL, image, options, plane);
+}
+
+bool binarize_bitplane_with_options_ctx(LineVisionContext* context, const Image* image, const BinarizationOptions* options, BitPlane* plane) {
+    return binarize_bitplane_options(context, image, options, plane);
+}
@@ -0,0 +1,202 @@
+#include "bitslice.h"
+#include "decode.h"
+#include "scanline.h"
+#include <string.h>
+
+void transpose_bits_64x64(uint64_t block[64]) {
+    uint64_t mask = UINT64_C(0x00000000FFFFFFFF);
+
+    for (size_t j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (size_t k = 0; k < 64; k = (k + j + 1) & ~j) {
+            // high columns of row k swap with low columns of row k + j
+            uint64_t swap = ((block[k] >> j) ^ block[k + j]) & mask;
+            block[k + j] ^= swap;
+            block[k] ^= swap << j;
+        }
+    }
+}
+
+void transpose_bitplane_band(const BitPlane* plane, int y0, uint64_t* columns) {
+    int rows = plane->height - y0 < BITSLICE_ROWS ? plane->height - y0 : BITSLICE_ROWS;
+
+    for (size_t w = 0; w < plane->stride; w++) {
+        uint64_t* block = &columns[w * 64];
+
+        for (int k = 0; k < BITSLICE_ROWS; k++) {
+            block[k] = k < rows ? bitplane_row(plane, y0 + k)[w] : 0;
+        }
+
+        transpose_bits_64x64(block);
+    }
+}
+
+// rows where the 7 sampled columns spell `code`, most significant module first
+static inline uint64_t match_code(const uint64_t* modules, int code) {
+    uint64_t match = ~UINT64_C(0);
+    for (int i = 0; i < 7; i++) {
+        match &= (code >> (6 - i)) & 1 ? modules[i] : ~modules[i];
+    }
+    return match;
+}
+
+// rows of `candidates` where all 8 characters match a code, with the digit masks of each
+static uint64_t match_digits(const uint64_t* modules, uint64_t candidates, uint64_t digits[EAN8_DIGIT_COUNT][10]) {
+    for (size_t j = 0; j < EAN8_DIGIT_COUNT && candidates; j++) {
+        const uint64_t* character = j < 4 ? &modules[3 + j * 7] : &modules[3 + 4 * 7 + 5 + (j - 4) * 7];
+        const int* codes = j < 4 ? L_CODE : R_CODE;
+
+        uint64_t any = 0;
+        for (int d = 0; d < 10; d++) {
+            digits[j][d] = match_code(character, codes[d]);
+            any |= digits[j][d];
+        }
+
+        candidates &= any;
+    }
+
+    return candidates;
+}
+
+static void read_digits(uint64_t digits[EAN8_DIGIT_COUNT][10], size_t row, int values[EAN8_DIGIT_COUNT]) {
+    for (size_t j = 0; j < EAN8_DIGIT_COUNT; j++) {
+        for (int d = 0; d < 10; d++) {
+            if ((digits[j][d] >> row) & 1) values[j] = d;
+        }
+    }
+}
+
+EAN8Error decode_columns_ean8(const uint64_t* columns, size_t width, uint64_t rows, uint32_t module, EAN8Result* result, uint64_t* pmatch) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    result->recovered = false;
+    result->confidence = EAN8_CONFIDENCE_EXACT;
+    if (!columns || module == 0) return result->status;
+
+    if (pmatch) *pmatch = 0;
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+
+    // module centers relative to the start column, the same for every start
+    size_t offsets[EAN8_MODULE_COUNT];
+    for (size_t i = 0; i < EAN8_LENGTH; i++) {
+        offsets[i] = (size_t)(((uint64_t)i * module + module / 2) >> MODULE_FIXED_SHIFT);
+    }
+
+    size_t span = offsets[EAN8_LENGTH - 1] + 1;
+
+    for (size_t x = 0; x + span <= width; x++) {
+        uint64_t modules[EAN8_MODULE_COUNT];
+        for (size_t i = 0; i < EAN8_LENGTH; i++) modules[i] = columns[x + offsets[i]];
+
+        // start (101), middle (01010) and end (101) guards for 64 rows
+        uint64_t guards = rows &
+            modules[0] & ~modules[1] & modules[2] &
+            ~modules[31] & modules[32] & ~modules[33] & modules[34] & ~modules[35] &
+            modules[64] & ~modules[65] & modules[66];
+        if (!guards) continue;
+
+        uint64_t digits[EAN8_DIGIT_COUNT][10];
+        uint64_t decoded = match_digits(modules, guards, digits);
+
+        if (!decoded) {
+            if (result->status == EAN8_ERROR_INVALID_FORMAT) {
+                memset(result->digits, EAN8_DIGIT_UNKNOWN, EAN8_DIGIT_COUNT);
+                result->status = EAN8_ERROR_INVALID_DECODE;
+            }
+            continue;
+        }
+
+        for (uint64_t pending = decoded; pending; pending &= pending - 1) {
+            size_t row = (size_t)__builtin_ctzll(pending);
+
+            int values[EAN8_DIGIT_COUNT];
+            read_digits(digits, row, values);
+
+            for (size_t j = 0; j < EAN8_DIGIT_COUNT; j++) result->digits[j] = (uint8_t)values[j];
+
+            if (compute_check_digit(values, EAN8_DIGIT_COUNT) != values[7]) {
+                result->status = EAN8_ERROR_INVALID_CHECKSUM;
+                continue;
+            }
+
+            // rows agreeing on every digit
+            uint64_t match = decoded;
+            for (size_t j = 0; j < EAN8_DIGIT_COUNT; j++) match &= digits[j][values[j]];
+
+            result->status = EAN8_ERROR_NONE;
+            if (pmatch) *pmatch = match;
+            return result->status;
+        }
+    }
+
+    return result->status;
+}
+
+// how far a failed band got, the best failure is reported
+static int band_rank(EAN8Error error) {
+    switch (error) {
+        case EAN8_ERROR_INVALID_CHECKSUM: return 2;
+        case EAN8_ERROR_INVALID_DECODE: return 1;
+        default: return 0;
+    }
+}
+
+EAN8Error decode_band_ean8(LineVisionContext* context, const BitPlane* plane, int y0, EAN8Result* result, uint64_t* pmatch) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (pmatch) *pmatch = 0;
+    if (!context || !plane || !plane->bits || y0 < 0 || y0 >= plane->height) return result->status;
+
+    size_t mark = linevision_context_mark(context);
+
+    Scanline* scanline = create_scanline_ctx(context, plane->width);
+    uint64_t* columns = linevision_context_alloc(context, plane->stride * 64 * sizeof(uint64_t));
+
+    if (!scanline || !columns) {
+        rewind_linevision_context(context, mark);
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+        return result->status;
+    }
+
+    int n_rows = plane->height - y0 < BITSLICE_ROWS ? plane->height - y0 : BITSLICE_ROWS;
+    uint64_t rows = n_rows == 64 ? ~UINT64_C(0) : (UINT64_C(1) << n_rows) - 1;
+
+    transpose_bitplane_band(plane, y0, columns);
+
+    // module width estimated on a few probe rows, each estimate tried on the whole band
+    static const int probes[] = { 32, 16, 48 };
+    uint32_t tried[3];
+    size_t n_tried = 0;
+
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+
+    for (size_t p = 0; p < 3; p++) {
+        int y = y0 + probes[p];
+        if (y >= plane->height) y = y0 + n_rows / 2;
+
+        if (!build_scanline_bits(scanline, bitplane_row(plane, y), plane->width)) {
+            result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+            break;
+        }
+
+        uint32_t module = find_module_fixed_scanline(scanline, 0, NULL);
+        if (module == 0) continue;
+
+        bool seen = false;
+        for (size_t i = 0; i < n_tried; i++) seen |= tried[i] == module;
+        if (seen) continue;
+        tried[n_tried++] = module;
+
+        EAN8Result band;
+        if (decode_columns_ean8(columns, plane->width, rows, module, &band, pmatch) == EAN8_ERROR_NONE) {
+            *result = band;
+            break;
+        }
+
+        if (band_rank(band.status) > band_rank(result->status)) *result = band;
+    }
+
+    rewind_linevision_context(context, mark);
+    return result->status;
+}
@@ -0,0 +1,76 @@
+#include "consensus.h"
+#include <string.h>
+
+void init_digit_consensus(DigitConsensus* consensus, size_t min_votes) {
+    if (!consensus) return;
+
+    memset(consensus->votes, 0, sizeof(consensus->votes));
+    consensus->reads = 0;
+    consensus->min_votes = min_votes == 0 ? 1 : min_votes;
+}
+
+bool add_digit_votes(DigitConsensus* consensus, const EAN8Result* read) {
+    if (!consensus || !read) return false;
+
+    if (read->status != EAN8_ERROR_NONE && read->status != EAN8_ERROR_INVALID_CHECKSUM &&
+        read->status != EAN8_ERROR_INVALID_DECODE) {
+        return false;
+    }
+
+    // a digit solved from the check digit would vote for its own checksum
+    if (read->recovered) return false;
+
+    for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) {
+        if (read->digits[i] < 10) consensus->votes[i][read->digits[i]]++;
+    }
+
+    consensus->reads++;
+    return true;
+}
+
+EAN8Error digit_consensus_result(const DigitConsensus* consensus, EAN8Result* result) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    result->recovered = false;
+    result->confidence = 0;
+    if (!consensus) return result->status;
+
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+    if (consensus->reads == 0) return result->status;
+
+    int digits[EAN8_DIGIT_COUNT];
+    bool confident = true;
+
+    for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) {
+        const uint32_t* votes = consensus->votes[i];
+        uint32_t total = 0;
+        int best = 0;
+
+        for (int d = 0; d < 10; d++) {
+            total += votes[d];
+            if (votes[d] > votes[best]) best = d;
+        }
+
+        if (votes[best] >= consensus->min_votes && 2 * votes[best] > total) {
+            digits[i] = best;
+            result->digits[i] = (uint8_t)best;
+        } else {
+            confident = false;
+            result->digits[i] = EAN8_DIGIT_UNKNOWN;
+        }
+    }
+
+    if (!confident) {
+        result->status = EAN8_ERROR_INVALID_DECODE;
+        return result->status;
+    }
+
+    // no single read confirmed every digit
+    result->confidence = 1;
+
+    int check_digit = compute_check_digit(digits, EAN8_DIGIT_COUNT);
+    result->status = check_digit == digits[7] ? EAN8_ERROR_NONE : EAN8_ERROR_INVALID_CHECKSUM;
+
+    return result->status;
+}
@@ -0,0 +1,128 @@
+#include "context.h"
+#include <stdalign.h>
+#include <stdlib.h>
+
+// header of a heap block used when the arena is full
+typedef struct OverflowBlock {
+    struct OverflowBlock* next;
+    /** value of `used` before the block was handed out, for rewinds */
+    size_t mark;
+    alignas(max_align_t) uint8_t data[];
+} OverflowBlock;
+
+static size_t align_size(size_t size) {
+    size_t alignment = alignof(max_align_t);
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+LineVisionContext* create_linevision_context(size_t capacity) {
+    LineVisionContext* context = malloc(sizeof(LineVisionContext));
+    if (!context) return NULL;
+
+    capacity = align_size(capacity);
+
+    context->base = NULL;
+    if (capacity > 0) {
+        context->base = malloc(capacity);
+        if (!context->base) {
+            free(context);
+            return NULL;
+        }
+    }
+
+    context->capacity = capacity;
+    context->used = 0;
+    context->peak = 0;
+    context->overflow = NULL;
+
+    return context;
+}
+
+// frees the heap blocks handed out at or after `mark`, newest first
+static void free_overflow_since(LineVisionContext* context, size_t mark) {
+    OverflowBlock* block = context->overflow;
+    while (block && block->mark >= mark) {
+        OverflowBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    context->overflow = block;
+}
+
+static void free_overflow(LineVisionContext* context) {
+    free_overflow_since(context, 0);
+}
+
+void destroy_linevision_context(LineVisionContext* context) {
+    if (!context) return;
+
+    free_overflow(context);
+    free(context->base);
+    free(context);
+}
+
+void* linevision_context_alloc(LineVisionContext* context, size_t size) {
+    if (!context) return NULL;
+
+    size = align_size(size == 0 ? 1 : size);
+
+    size_t used = context->used + size;
+    if (used > context->peak) context->peak = used;
+
+    // nothing handed out yet: grow the arena itself rather than overflow
+    if (used > context->capacity && context->used == 0) {
+        uint8_t* base = malloc(size);
+        if (base) {
+            free(context->base);
+            context->base = base;
+            context->capacity = size;
+        }
+    }
+
+    if (used <= context->capacity) {
+        void* memory = context->base + context->used;
+        context->used = used;
+        return memory;
+    }
+
+    // arena is full: keep counting the request and serve it from the heap
+    context->used = used;
+
+    OverflowBlock* block = malloc(sizeof(OverflowBlock) + size);
+    if (!block) return NULL;
+
+    block->next = context->overflow;
+    block->mark = used - size;
+    context->overflow = block;
+
+    return block->data;
+}
+
+size_t linevision_context_mark(const LineVisionContext* context) {
+    return context ? context->used : 0;
+}
+
+void rewind_linevision_context(LineVisionContext* context, size_t mark) {
+    if (!context || mark > context->used) return;
+
+    free_overflow_since(context, mark);
+    context->used = mark;
+}
+
+void reset_linevision_context(LineVisionContext* context) {
+    if (!context) return;
+
+    if (context->overflow) {
+        free_overflow(context);
+
+        // content is discarded, so no need for realloc to copy it
+        uint8_t* base = malloc(context->peak);
+        if (base) {
+            free(context->base);
+            context->base = base;
+            context->capacity = context->peak;
+        }
+    }
+
+    context->used = 0;
+}
@@ -0,0 +1,22 @@
+#include "cpu_features.h"
+#include <pthread.h>
+
+static unsigned features;
+static pthread_once_t features_once = PTHREAD_ONCE_INIT;
+
+static void detect_features(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2")) features |= CPU_FEATURE_SSE2;
+    if (__builtin_cpu_supports("ssse3")) features |= CPU_FEATURE_SSSE3;
+    if (__builtin_cpu_supports("sse4.1")) features |= CPU_FEATURE_SSE41;
+    if (__builtin_cpu_supports("avx2")) features |= CPU_FEATURE_AVX2;
+    if (__builtin_cpu_supports("popcnt")) features |= CPU_FEATURE_POPCNT;
+#endif
+}
+
+unsigned cpu_features(void) {
+    pthread_once(&features_once, detect_features);
+    return features;
+}
@@ -1,12 +1,29 @@
 #include "decode.h"
+#include "ean_patterns.h"
 #include <stdlib.h>
+#include <string.h>
 
-size_t find_module(const uint8_t* segment, int length) {
-    if (!segment || length <= 0) return 0;
+// widest bar counted by find_module_scanline(), bounds its histogram on the stack
+#define MAX_SCANLINE_MODULE 1024
+
+static size_t most_frequent_width(const int* hist, int max_module_width) {
+    int max_count = 0;
+    size_t module_width = 1;
+
+    // find the max
+    for (int i = 1; i <= max_module_width; i++) {
+        if (hist[i] > max_count) {
+            max_count = hist[i];
+            module_width = i;
+        }
+    }
 
+    return module_width;
+}
+
+// hist must hold length / 10 + 1 zeroed counters
+static size_t find_module_hist(const uint8_t* segment, int length, int* hist) {
     int max_module_width = length / 10;
-    int* hist = calloc(max_module_width + 1 , sizeof(int));
-    if (!hist) return 0;
 
     int counter = 0;
     uint8_t current_color = segment[0];
@@ -28,17 +45,77 @@ size_t find_module(const uint8_t* segment, int length) {
         hist[counter]++;
     }
 
-    int max_count = 0;
-    size_t module_width = 1;
+    return most_frequent_width(hist, max_module_width);
+}
 
-    // find the max
-    for (int i = 1; i <= max_module_width; i++) {
-        if (hist[i] > max_count) {
-            max_count = hist[i];
-            module_width = i;
+size_t find_module_scanline(const Scanline* scanline) {
+    if (!scanline || scanline->width == 0) return 0;
+
+    int max_module_width = (int)(scanline->width / 10);
+    if (max_module_width > MAX_SCANLINE_MODULE) max_module_width = MAX_SCANLINE_MODULE;
+
+    int hist[MAX_SCANLINE_MODULE + 1];
+    memset(hist, 0, (max_module_width + 1) * sizeof(int));
+
+    for (size_t i = 0; i < scanline->count; i++) {
+        const Run* run = &scanline->runs[i];
+        if (run->color == 1 && run->length <= (size_t)max_module_width) {
+            hist[run->length]++;
         }
     }
 
+    return most_frequent_width(hist, max_module_width);
+}
+
+size_t find_module(const uint8_t* segment, int length) {
+    if (!segment || length <= 0) return 0;
+
+    int* hist = calloc(length / 10 + 1, sizeof(int));
+    if (!hist) return 0;
+
+    size_t module_width = find_module_hist(segment, length, hist);
+
     free(hist);
     return module_width;
 }
+
+size_t find_module_ctx(LineVisionContext* context, const uint8_t* segment, int length) {
+    if (!segment || length <= 0) return 0;
+
+    size_t size = (length / 10 + 1) * sizeof(int);
+    int* hist = linevision_context_alloc(context, size);
+    if (!hist) return 0;
+
+    memset(hist, 0, size);
+    return find_module_hist(segment, length, hist);
+}
+
+// whether every run is within half a module of span / 67
+static bool is_module_runs(const Run* runs, size_t count, size_t span) {
+    for (size_t i = 0; i < count; i++) {
+        size_t scaled = 2 * EAN8_MODULE_COUNT * runs[i].length;
+        if (scaled < span || scaled > 3 * span) return false;
+    }
+    return true;
+}
+
+uint32_t find_module_fixed_scanline(const Scanline* scanline, size_t from, size_t* prun) {
+    if (!scanline) return 0;
+
+    for (size_t i = from; i + EAN8_RUN_COUNT <= scanline->count; i++) {
+        const Run* runs = &scanline->runs[i];
+        if (runs[0].color != 1) continue;
+
+        const Run* last = &runs[EAN8_RUN_COUNT - 1];
+        size_t span = last->start + last->length - runs[0].start;
+
+        if (is_module_runs(runs, 3, span) &&
+            is_module_runs(&runs[3 + 4 * 4], 5, span) &&
+            is_module_runs(&runs[EAN8_RUN_COUNT - 3], 3, span)) {
+            if (prun) *prun = i;
+            return (uint32_t)(((uint64_t)span << MODULE_FIXED_SHIFT) / EAN8_MODULE_COUNT);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include "detect.h"
+#include "decode.h"
+#include "image_kernels.h"
+#include "scanline.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// barcodes remembered per row
+#define MAX_ROW_READS 32
+
+// one barcode read on one row
+typedef struct {
+    EAN8Result result;
+    int left;
+    int right;
+} RowRead;
+
+// state shared by the workers of one detection
+typedef struct {
+    const Image* image;
+    int threshold;
+    const ScanOptions* options;
+
+    atomic_size_t next_index;
+    atomic_size_t visited;
+
+    pthread_mutex_t lock;
+    Detection* detections;
+    size_t capacity;
+    size_t count;
+    bool out_of_memory;
+} SharedDetection;
+
+typedef struct {
+    SharedDetection* detection;
+    LineVisionContext* context;
+} DetectWorker;
+
+// read overlapping pixels left..right, or NULL
+static const RowRead* find_overlapping_read(const RowRead* reads, size_t count, int left, int right) {
+    for (size_t i = 0; i < count; i++) {
+        if (left < reads[i].right && reads[i].left < right) return &reads[i];
+    }
+    return NULL;
+}
+
+// all the barcodes of one row, each search resuming past the previous barcode
+static size_t decode_row_all(const Scanline* scanline, RowRead* reads) {
+    size_t count = 0;
+    size_t from = 0, run;
+    EAN8Result result;
+
+    while (count < MAX_ROW_READS && decode_scanline_edges_ean8_from(scanline, from, &result, &run) == EAN8_ERROR_NONE) {
+        const Run* last = &scanline->runs[run + EAN8_RUN_COUNT - 1];
+
+        reads[count].result = result;
+        reads[count].left = (int)scanline->runs[run].start;
+        reads[count].right = (int)(last->start + last->length);
+        count++;
+
+        from = run + EAN8_RUN_COUNT;
+    }
+
+    // sub-pixel module sampling where the ratios found nothing
+    uint32_t fixed;
+    from = 0;
+    while (count < MAX_ROW_READS && (fixed = find_module_fixed_scanline(scanline, from, &run)) != 0) {
+        int left = (int)scanline->runs[run].start;
+        int right = left + (int)(((uint64_t)fixed * EAN8_MODULE_COUNT) >> MODULE_FIXED_SHIFT);
+
+        // windows starting inside a barcode already read are all rejected
+        const RowRead* read = find_overlapping_read(reads, count, left, right);
+        if (read && read->left <= left) {
+            size_t past = find_run_scanline(scanline, (size_t)read->right);
+            from = past > run ? past : run + 2;
+            continue;
+        }
+
+        // a digit filled in from the check digit is not a confirmed barcode
+        EAN8Segment segment;
+        if (!read &&
+            sample_segment_ean8_scanline(scanline, left, fixed, &segment) == EAN8_ERROR_NONE &&
+            decode_segment_ean8(&segment, &result) == EAN8_ERROR_NONE && !result.recovered) {
+            reads[count].result = result;
+            reads[count].left = left;
+            reads[count].right = right;
+            count++;
+
+            from = run + EAN8_RUN_COUNT;
+            continue;
+        }
+
+        // the next start guard begins on the next bar at the earliest
+        from = run + 2;
+    }
+
+    return count;
+}
+
+static bool is_same_barcode(const Detection* detection, const EAN8Result* result, int left, int right, int top, int bottom) {
+    if (memcmp(detection->result.digits, result->digits, EAN8_DIGIT_COUNT) != 0) return false;
+    if (left >= detection->right || detection->left >= right) return false;
+
+    // rows of one barcode are at most a fraction of its width apart
+    int gap = (detection->right - detection->left) / 2;
+    return top <= detection->bottom + gap && detection->top <= bottom + gap;
+}
+
+// adds a read of rows top..bottom to the detections, merging it with the same barcode
+static void add_read(SharedDetection* shared, const EAN8Result* result, int left, int right, int top, int bottom, size_t rows) {
+    for (size_t i = 0; i < shared->count; i++) {
+        Detection* detection = &shared->detections[i];
+        if (!is_same_barcode(detection, result, left, right, top, bottom)) continue;
+
+        if (left < detection->left) detection->left = left;
+        if (right > detection->right) detection->right = right;
+        if (top < detection->top) detection->top = top;
+        if (bottom > detection->bottom) detection->bottom = bottom;
+        detection->rows += rows;
+        return;
+    }
+
+    if (shared->count == shared->capacity) return;
+
+    Detection* detection = &shared->detections[shared->count++];
+    detection->result = *result;
+    detection->left = left;
+    detection->right = right;
+    detection->top = top;
+    detection->bottom = bottom;
+    detection->rows = rows;
+}
+
+static void* detect_worker(void* arg) {
+    DetectWorker* worker = arg;
+    SharedDetection* shared = worker->detection;
+    const ScanOptions* options = shared->options;
+    const Image* image = shared->image;
+    size_t width = image->width;
+
+    size_t mark = linevision_context_mark(worker->context);
+
+    uint64_t* bits = linevision_context_alloc(worker->context, ((width + 63) / 64) * sizeof(uint64_t));
+    Scanline* scanline = create_scanline_ctx(worker->context, width);
+    RowRead reads[MAX_ROW_READS];
+
+    if (!bits || !scanline) {
+        pthread_mutex_lock(&shared->lock);
+        shared->out_of_memory = true;
+        pthread_mutex_unlock(&shared->lock);
+        rewind_linevision_context(worker->context, mark);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&shared->next_index, 1);
+
+        int y = scan_schedule_row(options, image->height, index);
+        if (y == -1) break;
+        if (y < 0) continue;
+
+        if (options->max_rows != 0 && atomic_fetch_add(&shared->visited, 1) >= options->max_rows) break;
+
+        threshold_pack_u8(&image->data[(size_t)y * width], width, shared->threshold, bits);
+        if (!build_scanline_bits(scanline, bits, width)) continue;
+
+        size_t count = decode_row_all(scanline, reads);
+        if (count == 0) continue;
+
+        pthread_mutex_lock(&shared->lock);
+        for (size_t i = 0; i < count; i++) {
+            add_read(shared, &reads[i].result, reads[i].left, reads[i].right, y, y, 1);
+        }
+        pthread_mutex_unlock(&shared->lock);
+    }
+
+    rewind_linevision_context(worker->context, mark);
+    return NULL;
+}
+
+static int compare_detections(const void* a, const void* b) {
+    const Detection* first = a;
+    const Detection* second = b;
+
+    if (first->top != second->top) return first->top < second->top ? -1 : 1;
+    if (first->left != second->left) return first->left < second->left ? -1 : 1;
+    return 0;
+}
+
+// joins detections that grew into each other, then drops those with too few rows
+static size_t finish_detections(Detection* detections, size_t count, size_t min_rows) {
+    bool merged = true;
+
+    while (merged) {
+        merged = false;
+
+        for (size_t i = 0; i < count && !merged; i++) {
+            for (size_t j = i + 1; j < count && !merged; j++) {
+                Detection* a = &detections[i];
+                const Detection* b = &detections[j];
+                if (!is_same_barcode(a, &b->result, b->left, b->right, b->top, b->bottom)) continue;
+
+                if (b->left < a->left) a->left = b->left;
+                if (b->right > a->right) a->right = b->right;
+                if (b->top < a->top) a->top = b->top;
+                if (b->bottom > a->bottom) a->bottom = b->bottom;
+                a->rows += b->rows;
+
+                detections[j] = detections[--count];
+                merged = true;
+            }
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (detections[i].rows >= min_rows) detections[kept++] = detections[i];
+    }
+
+    qsort(detections, kept, sizeof(Detection), compare_detections);
+    return kept;
+}
+
+EAN8Error scan_all_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, Detection* detections, size_t capacity, size_t* pcount) {
+    if (pcount) *pcount = 0;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1 || !detections || !pcount) {
+        return EAN8_ERROR_INVALID_INPUT;
+    }
+
+    for (size_t i = 0; i < n_workers; i++) {
+        if (!contexts[i]) return EAN8_ERROR_INVALID_INPUT;
+    }
+
+    ScanOptions defaults;
+    if (!options) {
+        default_scan_options(&defaults);
+        options = &defaults;
+    }
+
+    SharedDetection shared;
+    shared.image = gray;
+    shared.threshold = threshold;
+    shared.options = options;
+    shared.detections = detections;
+    shared.capacity = capacity;
+    shared.count = 0;
+    shared.out_of_memory = false;
+    atomic_init(&shared.next_index, 0);
+    atomic_init(&shared.visited, 0);
+
+    if (pthread_mutex_init(&shared.lock, NULL) != 0) return EAN8_ERROR_MEMORY_ALLOCATION;
+
+    DetectWorker workers[n_workers];
+    pthread_t threads[n_workers];
+    size_t started = 1;
+
+    for (size_t i = 0; i < n_workers; i++) {
+        workers[i].detection = &shared;
+        workers[i].context = contexts[i];
+    }
+
+    // worker 0 runs on the calling thread
+    for (; started < n_workers; started++) {
+        if (pthread_create(&threads[started], NULL, detect_worker, &workers[started]) != 0) break;
+    }
+
+    detect_worker(&workers[0]);
+
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&shared.lock);
+
+    if (shared.out_of_memory) return EAN8_ERROR_MEMORY_ALLOCATION;
+
+    *pcount = finish_detections(detections, shared.count, options->votes == 0 ? 1 : options->votes);
+    return *pcount > 0 ? EAN8_ERROR_NONE : EAN8_ERROR_INVALID_FORMAT;
+}
+
+EAN8Error scan_all_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, Detection* detections, size_t capacity, size_t* pcount) {
+    return scan_all_ean8_parallel(&context, 1, gray, threshold, options, detections, capacity, pcount);
+}
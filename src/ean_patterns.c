@@ -1,16 +1,31 @@
 #include "ean_patterns.h"
+#include "cpu_features.h"
+#include "decode.h"
 #include "ean_errors.h"
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-const size_t EAN8_DIGITS = 8;
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EAN_PATTERNS_X86 1
+#endif
+
+// lanes of match_code_ean(): L digits, G digits, R digits, 2 unused lanes
+#define MATCH_LANES 32
+// a match key is (distance << MATCH_LANE_BITS) | lane, 0xFF for a lane left out
+#define MATCH_LANE_BITS 5
+#define MATCH_LANE_MASK ((1u << MATCH_LANE_BITS) - 1)
+#define MATCH_EXCLUDED 0xFF
+
+const size_t EAN8_DIGITS = EAN8_DIGIT_COUNT;
 const size_t EAN13_DIGITS = 13;
 
-const size_t EAN8_LENGTH = 67;
+const size_t EAN8_LENGTH = EAN8_MODULE_COUNT;
 const size_t EAN8_SET_LENGTH = 28;
 const size_t EAN8_CODE_LENGTH = 7;
+const size_t EAN8_RUN_COUNT = EAN8_WINDOW_RUNS;
 
 const int L_CODE[10] = {
   0b0001101,
@@ -38,6 +53,87 @@ const int R_CODE[10] = {
   0b1110100,
 };
 
+const int G_CODE[10] = {
+  0b0100111,
+  0b0110011,
+  0b0011011,
+  0b0100001,
+  0b0011101,
+  0b0111001,
+  0b0000101,
+  0b0010001,
+  0b0001001,
+  0b0010111,
+};
+
+const EANCodeEntry EAN_CODE_TABLE[128] = {
+    [0b0000101] = { 6, EAN_SET_G, 6, EAN_SET_R },
+    [0b0001001] = { 8, EAN_SET_G, 8, EAN_SET_R },
+    [0b0001011] = { 9, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0001101] = { 0, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0010001] = { 7, EAN_SET_G, 7, EAN_SET_R },
+    [0b0010011] = { 2, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0010111] = { 9, EAN_SET_G, 9, EAN_SET_R },
+    [0b0011001] = { 1, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0011011] = { 2, EAN_SET_G, 2, EAN_SET_R },
+    [0b0011101] = { 4, EAN_SET_G, 4, EAN_SET_R },
+    [0b0100001] = { 3, EAN_SET_G, 3, EAN_SET_R },
+    [0b0100011] = { 4, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0100111] = { 0, EAN_SET_G, 0, EAN_SET_R },
+    [0b0101111] = { 6, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0110001] = { 5, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0110011] = { 1, EAN_SET_G, 1, EAN_SET_R },
+    [0b0110111] = { 8, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0111001] = { 5, EAN_SET_G, 5, EAN_SET_R },
+    [0b0111011] = { 7, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b0111101] = { 3, EAN_SET_L, 0, EAN_SET_NONE },
+    [0b1000010] = { 3, EAN_SET_R, 3, EAN_SET_G },
+    [0b1000100] = { 7, EAN_SET_R, 7, EAN_SET_G },
+    [0b1000110] = { 0, EAN_SET_NONE, 5, EAN_SET_L },
+    [0b1001000] = { 8, EAN_SET_R, 8, EAN_SET_G },
+    [0b1001100] = { 0, EAN_SET_NONE, 1, EAN_SET_L },
+    [0b1001110] = { 5, EAN_SET_R, 5, EAN_SET_G },
+    [0b1010000] = { 6, EAN_SET_R, 6, EAN_SET_G },
+    [0b1011000] = { 0, EAN_SET_NONE, 0, EAN_SET_L },
+    [0b1011100] = { 4, EAN_SET_R, 4, EAN_SET_G },
+    [0b1011110] = { 0, EAN_SET_NONE, 3, EAN_SET_L },
+    [0b1100010] = { 0, EAN_SET_NONE, 4, EAN_SET_L },
+    [0b1100100] = { 0, EAN_SET_NONE, 2, EAN_SET_L },
+    [0b1100110] = { 1, EAN_SET_R, 1, EAN_SET_G },
+    [0b1101000] = { 0, EAN_SET_NONE, 9, EAN_SET_L },
+    [0b1101100] = { 2, EAN_SET_R, 2, EAN_SET_G },
+    [0b1101110] = { 0, EAN_SET_NONE, 7, EAN_SET_L },
+    [0b1110010] = { 0, EAN_SET_R, 0, EAN_SET_G },
+    [0b1110100] = { 9, EAN_SET_R, 9, EAN_SET_G },
+    [0b1110110] = { 0, EAN_SET_NONE, 8, EAN_SET_L },
+    [0b1111010] = { 0, EAN_SET_NONE, 6, EAN_SET_L },
+};
+
+// samples the row into segment->data and searches the structure with the given scratch words
+static bool fill_segment_ean(SegmentEAN* segment, uint64_t* words, const uint8_t* data, size_t module) {
+    size_t n_modules = segment->length;
+
+    // binarization of grayscale pixels (white = 0 and black = 1), sampled at module centers
+    for (size_t i = 0; i < n_modules; i++) {
+        segment->data[i] = data[i * module + module / 2] == 0 ? 1 : 0;
+    }
+
+    segment->start = 0;
+    segment->middle = 0;
+    segment->end = 0;
+
+    // find the EAN structure
+    pack_modules(segment->data, n_modules, words);
+    size_t index = find_structure_packed(words, n_modules, 0);
+    if (index == n_modules) return false;
+
+    segment->start = index;
+    segment->middle = index + 3 + EAN8_SET_LENGTH;
+    segment->end = index + 3 + 5 + EAN8_SET_LENGTH * 2;
+
+    return true;
+}
+
 SegmentEAN* create_segment_ean(const uint8_t* data, size_t length, size_t module) {
     SegmentEAN* segment = malloc(sizeof(SegmentEAN));
     if (!segment) return NULL;
@@ -51,37 +147,253 @@ SegmentEAN* create_segment_ean(const uint8_t* data, size_t length, size_t module
 
     segment->length = n_modules;
 
-    // binarization of grayscale pixels (white = 0 and black = 1)
-    for (size_t i = 0; i < n_modules; i++) {
-        segment->data[i] = data[i * module] == 0 ? 1 : 0;
+    uint64_t* words = malloc(packed_modules_words(n_modules) * sizeof(uint64_t));
+    if (!words) {
+        free(segment->data);
+        free(segment);
+        return NULL;
     }
 
-    segment->start = 0;
-    segment->middle = 0;
-    segment->end = 0;
+    bool is_valid = fill_segment_ean(segment, words, data, module);
+    free(words);
+
+    if (!is_valid) {
+        free(segment->data);
+        free(segment);
+        return NULL;
+    }
 
-    bool is_valid = false;
+    return segment;
+}
 
-    // find the EAN structure
-    for (size_t i = 0; i < segment->length; i++) {
-        if (is_valid_structure(segment->data, segment->length, i)) {
-            is_valid = true;
-            segment->start = i;
-            segment->middle = i + 3 + EAN8_SET_LENGTH;
-            segment->end = i + 3 + 5 + EAN8_SET_LENGTH * 2;
-            break;
+SegmentEAN* create_segment_ean_ctx(LineVisionContext* context, const uint8_t* data, size_t length, size_t module) {
+    if (!data || module == 0) return NULL;
+
+    SegmentEAN* segment = linevision_context_alloc(context, sizeof(SegmentEAN));
+    if (!segment) return NULL;
+
+    size_t n_modules = length / module;
+    segment->length = n_modules;
+    segment->data = linevision_context_alloc(context, n_modules * sizeof(uint8_t));
+    uint64_t* words = linevision_context_alloc(context, packed_modules_words(n_modules) * sizeof(uint64_t));
+    if (!segment->data || !words) return NULL;
+
+    if (!fill_segment_ean(segment, words, data, module)) return NULL;
+
+    return segment;
+}
+
+static size_t quantize_run(const Run* run, size_t module) {
+    size_t modules = (run->length + module / 2) / module;
+    return modules == 0 ? 1 : modules;
+}
+
+static bool is_single_module_runs(const Scanline* scanline, size_t index, size_t count, size_t module) {
+    for (size_t i = index; i < index + count; i++) {
+        if (quantize_run(&scanline->runs[i], module) != 1) return false;
+    }
+    return true;
+}
+
+// index of the first run, from run `from` on, of a valid EAN structure, or scanline->count
+static size_t find_structure_runs(const Scanline* scanline, size_t from, size_t module) {
+    size_t middle_run = 3 + 4 * 4;
+    size_t end_run = EAN8_RUN_COUNT - 3;
+
+    for (size_t i = from; i + EAN8_RUN_COUNT <= scanline->count; i++) {
+        if (scanline->runs[i].color == 1 &&
+            is_single_module_runs(scanline, i, 3, module) &&
+            is_single_module_runs(scanline, i + middle_run, 5, module) &&
+            is_single_module_runs(scanline, i + end_run, 3, module)) {
+            size_t total = 0;
+            for (size_t j = i; j < i + EAN8_RUN_COUNT; j++) {
+                total += quantize_run(&scanline->runs[j], module);
+            }
+
+            if (total == EAN8_LENGTH) return i;
         }
     }
 
-    if (!is_valid) {
-        free(segment->data);
+    return scanline->count;
+}
+
+// samples the first structure whose modules read back with valid guards,
+// at module centers spaced by the width of its runs over 67 modules
+static EAN8Error sample_structure_runs(const Scanline* scanline, size_t module, EAN8Segment* segment, size_t* pstart, uint32_t* pfixed) {
+    for (size_t i = 0; (i = find_structure_runs(scanline, i, module)) < scanline->count; i++) {
+        const Run* first = &scanline->runs[i];
+        const Run* last = &scanline->runs[i + EAN8_RUN_COUNT - 1];
+        size_t span = last->start + last->length - first->start;
+        uint32_t fixed = (uint32_t)(((uint64_t)span << MODULE_FIXED_SHIFT) / EAN8_LENGTH);
+
+        if (sample_segment_ean8_scanline(scanline, first->start, fixed, segment) == EAN8_ERROR_NONE) {
+            if (pstart) *pstart = first->start;
+            if (pfixed) *pfixed = fixed;
+            return EAN8_ERROR_NONE;
+        }
+    }
+
+    return EAN8_ERROR_INVALID_FORMAT;
+}
+
+static void copy_segment_ean(SegmentEAN* segment, const EAN8Segment* sampled) {
+    memcpy(segment->data, sampled->data, EAN8_LENGTH);
+
+    segment->length = EAN8_LENGTH;
+    segment->start = 0;
+    segment->middle = 3 + EAN8_SET_LENGTH;
+    segment->end = 3 + 5 + EAN8_SET_LENGTH * 2;
+}
+
+SegmentEAN* create_segment_ean_scanline(const Scanline* scanline, size_t module) {
+    if (!scanline || module == 0) return NULL;
+
+    EAN8Segment sampled;
+    if (sample_structure_runs(scanline, module, &sampled, NULL, NULL) != EAN8_ERROR_NONE) return NULL;
+
+    SegmentEAN* segment = malloc(sizeof(SegmentEAN));
+    if (!segment) return NULL;
+
+    segment->data = malloc(EAN8_LENGTH * sizeof(uint8_t));
+    if (!segment->data) {
         free(segment);
         return NULL;
     }
 
+    copy_segment_ean(segment, &sampled);
+
     return segment;
 }
 
+SegmentEAN* create_segment_ean_scanline_ctx(LineVisionContext* context, const Scanline* scanline, size_t module) {
+    if (!scanline || module == 0) return NULL;
+
+    EAN8Segment sampled;
+    if (sample_structure_runs(scanline, module, &sampled, NULL, NULL) != EAN8_ERROR_NONE) return NULL;
+
+    SegmentEAN* segment = linevision_context_alloc(context, sizeof(SegmentEAN));
+    if (!segment) return NULL;
+
+    segment->data = linevision_context_alloc(context, EAN8_LENGTH * sizeof(uint8_t));
+    if (!segment->data) return NULL;
+
+    copy_segment_ean(segment, &sampled);
+
+    return segment;
+}
+
+// samples `count` modules starting at module `base` straight into packed words, at module centers
+static void sample_modules_packed(const uint8_t* data, size_t module, size_t base, size_t count, uint64_t* words) {
+    memset(words, 0, packed_modules_words(count) * sizeof(uint64_t));
+
+    const uint8_t* pixel = &data[base * module + module / 2];
+    for (size_t i = 0; i < count; i++, pixel += module) {
+        words[i >> 6] |= (uint64_t)(*pixel == 0) << (i & 63);
+    }
+}
+
+EAN8Error find_segment_ean8(const uint8_t* data, size_t length, size_t module, EAN8Segment* segment) {
+    if (!data || !segment || module == 0) return EAN8_ERROR_INVALID_INPUT;
+
+    // bitstream is packed and searched by chunks that overlap by one structure
+    enum { CHUNK_WORDS = 16, CHUNK_MODULES = CHUNK_WORDS * 64 };
+    uint64_t words[CHUNK_WORDS + 2];
+
+    size_t n_modules = length / module;
+
+    for (size_t base = 0; base + EAN8_LENGTH <= n_modules; base += CHUNK_MODULES - EAN8_LENGTH + 1) {
+        size_t count = n_modules - base < CHUNK_MODULES ? n_modules - base : CHUNK_MODULES;
+
+        sample_modules_packed(data, module, base, count, words);
+        size_t index = find_structure_packed(words, count, 0);
+        if (index == count) continue;
+
+        segment->start = base + index;
+        for (size_t i = 0; i < EAN8_LENGTH; i++) {
+            segment->data[i] = data[(segment->start + i) * module + module / 2] == 0 ? 1 : 0;
+        }
+
+        return EAN8_ERROR_NONE;
+    }
+
+    return EAN8_ERROR_INVALID_FORMAT;
+}
+
+EAN8Error find_segment_ean8_scanline(const Scanline* scanline, size_t module, EAN8Segment* segment, size_t* pstart, uint32_t* pfixed) {
+    if (!scanline || !segment || module == 0) return EAN8_ERROR_INVALID_INPUT;
+
+    return sample_structure_runs(scanline, module, segment, pstart, pfixed);
+}
+
+EAN8Error sample_segment_ean8_scanline(const Scanline* scanline, size_t start, uint32_t module, EAN8Segment* segment) {
+    if (!scanline || !segment || module == 0) return EAN8_ERROR_INVALID_INPUT;
+
+    // position of the center of module 0 in fixed point, advanced by one module per sample
+    uint64_t position = ((uint64_t)start << MODULE_FIXED_SHIFT) + module / 2;
+    size_t run = find_run_scanline(scanline, start);
+
+    for (size_t i = 0; i < EAN8_LENGTH; i++, position += module) {
+        size_t pixel = (size_t)(position >> MODULE_FIXED_SHIFT);
+        if (pixel >= scanline->width) return EAN8_ERROR_INVALID_FORMAT;
+
+        while (scanline->runs[run].start + scanline->runs[run].length <= pixel) run++;
+        segment->data[i] = scanline->runs[run].color;
+    }
+
+    segment->start = (size_t)(((uint64_t)start << MODULE_FIXED_SHIFT) / module);
+
+    return is_valid_structure(segment->data, EAN8_LENGTH, 0) ? EAN8_ERROR_NONE : EAN8_ERROR_INVALID_FORMAT;
+}
+
+static inline uint8_t bit_at(const uint64_t* bits, size_t position) {
+    return (bits[position >> 6] >> (position & 63)) & 1;
+}
+
+EAN8Error find_segment_ean8_bits(const uint64_t* bits, size_t length, size_t module, EAN8Segment* segment) {
+    if (!bits || !segment || module == 0) return EAN8_ERROR_INVALID_INPUT;
+
+    size_t n_modules = length / module;
+    size_t start = n_modules;
+
+    if (module == 1) {
+        start = find_structure_packed(bits, n_modules, 0);
+    } else {
+        enum { CHUNK_WORDS = 16, CHUNK_MODULES = CHUNK_WORDS * 64 };
+        uint64_t words[CHUNK_WORDS + 2];
+
+        for (size_t base = 0; base + EAN8_LENGTH <= n_modules; base += CHUNK_MODULES - EAN8_LENGTH + 1) {
+            size_t count = n_modules - base < CHUNK_MODULES ? n_modules - base : CHUNK_MODULES;
+
+            memset(words, 0, packed_modules_words(count) * sizeof(uint64_t));
+            for (size_t i = 0; i < count; i++) {
+                words[i >> 6] |= (uint64_t)bit_at(bits, (base + i) * module + module / 2) << (i & 63);
+            }
+
+            size_t index = find_structure_packed(words, count, 0);
+            if (index < count) {
+                start = base + index;
+                break;
+            }
+        }
+    }
+
+    if (start >= n_modules) return EAN8_ERROR_INVALID_FORMAT;
+
+    segment->start = start;
+    for (size_t i = 0; i < EAN8_LENGTH; i++) {
+        segment->data[i] = bit_at(bits, (start + i) * module + module / 2);
+    }
+
+    return EAN8_ERROR_NONE;
+}
+
+void print_segment_ean8(const EAN8Segment* segment) {
+    for (size_t i = 0; i < EAN8_LENGTH; i++) {
+        printf("%d", segment->data[i]);
+    }
+    printf("\n");
+}
+
 bool is_valid_structure(const uint8_t* data, size_t length, size_t index) {
     if (index + EAN8_LENGTH > length) return false;
 
@@ -109,6 +421,56 @@ bool is_valid_structure(const uint8_t* data, size_t length, size_t index) {
     return true;
 }
 
+size_t packed_modules_words(size_t length) {
+    return (length + 63) / 64 + 2;
+}
+
+void pack_modules(const uint8_t* data, size_t length, uint64_t* words) {
+    memset(words, 0, packed_modules_words(length) * sizeof(uint64_t));
+
+    for (size_t i = 0; i < length; i++) {
+        words[i >> 6] |= (uint64_t)(data[i] & 1) << (i & 63);
+    }
+}
+
+// 64 bits of the packed bitstream starting at bit `position`
+static inline uint64_t packed_bits_at(const uint64_t* words, size_t position) {
+    size_t word = position >> 6;
+    unsigned shift = position & 63;
+    if (shift == 0) return words[word];
+    return (words[word] >> shift) | (words[word + 1] << (64 - shift));
+}
+
+size_t find_structure_packed(const uint64_t* words, size_t length, size_t from) {
+    if (length < EAN8_LENGTH) return length;
+
+    size_t last = length - EAN8_LENGTH; // last valid offset
+    size_t middle = 3 + EAN8_SET_LENGTH;
+    size_t end = EAN8_LENGTH - 3;
+
+    for (size_t base = from; base <= last; base += 64) {
+        const uint64_t* w = words;
+
+        // bit j of the result is set when a structure starts at base + j
+        uint64_t candidates =
+             packed_bits_at(w, base)              & ~packed_bits_at(w, base + 1)          &
+             packed_bits_at(w, base + 2)          &
+            ~packed_bits_at(w, base + middle)     &  packed_bits_at(w, base + middle + 1) &
+            ~packed_bits_at(w, base + middle + 2) &  packed_bits_at(w, base + middle + 3) &
+            ~packed_bits_at(w, base + middle + 4) &
+             packed_bits_at(w, base + end)        & ~packed_bits_at(w, base + end + 1)    &
+             packed_bits_at(w, base + end + 2);
+
+        if (last - base < 63) {
+            candidates &= (UINT64_C(1) << (last - base + 1)) - 1;
+        }
+
+        if (candidates) return base + (size_t)__builtin_ctzll(candidates);
+    }
+
+    return length;
+}
+
 void destroy_segment_ean(SegmentEAN* segment) {
     if (!segment) return;
     free(segment->data);
@@ -134,19 +496,154 @@ int compute_check_digit(const int* segment, const size_t size) {
     return check_digit == 10 ? 0 : check_digit;
 }
 
-int decode_code_ean8(const uint8_t* data, const int codes[10]) {
+int solve_check_digit(const int* segment, const size_t size, const size_t position) {
+    if (position >= size) return -1;
+    if (position == size - 1) return compute_check_digit(segment, size);
+
+    int sum = segment[size - 1];
+    for (size_t i = 0; i < size - 1; i++) {
+        if (i != position) sum += (i % 2 == 0) ? segment[i] * 3 : segment[i];
+    }
+
+    // weight * digit = -sum (mod 10), and 7 is the inverse of 3
+    int remainder = (10 - sum % 10) % 10;
+    return position % 2 == 0 ? (7 * remainder) % 10 : remainder;
+}
+
+static inline int fold_code(const uint8_t* data) {
     int value = 0;
     for (size_t i = 0; i < EAN8_CODE_LENGTH; i++) {
         value = (value << 1) | (data[i]);
     }
+    return value;
+}
+
+int decode_code_ean8(const uint8_t* data, const int codes[10]) {
+    int value = fold_code(data);
+
+    EANCodeEntry entry = EAN_CODE_TABLE[value];
+    if (entry.set == EAN_SET_NONE || codes[entry.digit] != value) return -1;
+
+    return entry.digit;
+}
+
+EANCodeEntry lookup_code_ean(const uint8_t* data) {
+    return EAN_CODE_TABLE[fold_code(data)];
+}
+
+// patterns by lane, L_CODE, G_CODE and R_CODE in a 32-byte vector
+static const uint8_t MATCH_PATTERNS[MATCH_LANES] __attribute__((aligned(16))) = {
+    0x0D, 0x19, 0x13, 0x3D, 0x23, 0x31, 0x2F, 0x3B, 0x37, 0x0B,
+    0x27, 0x33, 0x1B, 0x21, 0x1D, 0x39, 0x05, 0x11, 0x09, 0x17,
+    0x72, 0x66, 0x6C, 0x42, 0x5C, 0x4E, 0x50, 0x44, 0x48, 0x74,
+    0x00, 0x00,
+};
+
+// EAN_SET_MASK() of the set of each lane, 0 for the unused lanes
+static const uint8_t MATCH_SETS[MATCH_LANES] __attribute__((aligned(16))) = {
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+    0, 0,
+};
+
+static EANCodeMatch match_from_keys(unsigned best, unsigned second) {
+    if (best == MATCH_EXCLUDED) return (EANCodeMatch){ 0, EAN_SET_NONE, EAN8_CODE_LENGTH, 0 };
+
+    unsigned lane = best & MATCH_LANE_MASK;
+    EANCodeMatch match = {
+        .digit = (uint8_t)(lane % 10),
+        .set = (uint8_t)(EAN_SET_L + lane / 10),
+        .distance = (uint8_t)(best >> MATCH_LANE_BITS),
+        .margin = (uint8_t)((second >> MATCH_LANE_BITS) - (best >> MATCH_LANE_BITS)),
+    };
+    return match;
+}
 
-    for (int i = 0; i < 10; i++) {
-        if (value == codes[i]) {
-            return i;
+static EANCodeMatch match_value_scalar(int value, unsigned sets) {
+    unsigned best = MATCH_EXCLUDED, second = MATCH_EXCLUDED;
+
+    for (unsigned lane = 0; lane < MATCH_LANES; lane++) {
+        if (!(MATCH_SETS[lane] & sets)) continue;
+
+        unsigned key = ((unsigned)__builtin_popcount((unsigned)(value ^ MATCH_PATTERNS[lane])) << MATCH_LANE_BITS) | lane;
+        if (key < best) {
+            second = best;
+            best = key;
+        } else if (key < second) {
+            second = key;
         }
     }
 
-    return -1;
+    return match_from_keys(best, second);
+}
+
+#ifdef EAN_PATTERNS_X86
+__attribute__((target("ssse3")))
+static inline __m128i match_keys_ssse3(__m128i value, __m128i mask, size_t from) {
+    const __m128i nibble_counts = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low = _mm_set1_epi8(0x0F);
+
+    __m128i bits = _mm_xor_si128(_mm_load_si128((const __m128i*)&MATCH_PATTERNS[from]), value);
+    __m128i counts = _mm_add_epi8(_mm_shuffle_epi8(nibble_counts, _mm_and_si128(bits, low)),
+                                  _mm_shuffle_epi8(nibble_counts, _mm_and_si128(_mm_srli_epi16(bits, 4), low)));
+
+    // distance in the 3 high bits, lane in the 5 low ones
+    __m128i lanes = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm_set1_epi8((char)from));
+    __m128i keys = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(counts, MATCH_LANE_BITS), _mm_set1_epi8((char)0xE0)), lanes);
+
+    __m128i excluded = _mm_cmpeq_epi8(_mm_and_si128(_mm_load_si128((const __m128i*)&MATCH_SETS[from]), mask), _mm_setzero_si128());
+    return _mm_or_si128(keys, excluded);
+}
+
+__attribute__((target("ssse3")))
+static inline unsigned min_key_ssse3(__m128i keys) {
+    keys = _mm_min_epu8(keys, _mm_srli_si128(keys, 8));
+    keys = _mm_min_epu8(keys, _mm_srli_si128(keys, 4));
+    keys = _mm_min_epu8(keys, _mm_srli_si128(keys, 2));
+    keys = _mm_min_epu8(keys, _mm_srli_si128(keys, 1));
+    return (unsigned)_mm_cvtsi128_si32(keys) & 0xFF;
+}
+
+__attribute__((target("ssse3")))
+static EANCodeMatch match_value_ssse3(int value, unsigned sets) {
+    __m128i broadcast = _mm_set1_epi8((char)value);
+    __m128i mask = _mm_set1_epi8((char)sets);
+
+    __m128i low = match_keys_ssse3(broadcast, mask, 0);
+    __m128i high = match_keys_ssse3(broadcast, mask, 16);
+    unsigned best = min_key_ssse3(_mm_min_epu8(low, high));
+
+    // keys are unique by their lane: drop the nearest one for the runner-up
+    __m128i nearest = _mm_set1_epi8((char)best);
+    low = _mm_or_si128(low, _mm_cmpeq_epi8(low, nearest));
+    high = _mm_or_si128(high, _mm_cmpeq_epi8(high, nearest));
+    unsigned second = min_key_ssse3(_mm_min_epu8(low, high));
+
+    return match_from_keys(best, second);
+}
+#endif
+
+static EANCodeMatch match_value_ean(int value, unsigned sets) {
+#ifdef EAN_PATTERNS_X86
+    if (cpu_features() & CPU_FEATURE_SSSE3) return match_value_ssse3(value, sets);
+#endif
+    return match_value_scalar(value, sets);
+}
+
+EANCodeMatch match_code_ean(const uint8_t* data, unsigned sets) {
+    return match_value_ean(fold_code(data), sets);
+}
+
+static bool decode_set_ean8(const uint8_t* data, const int codes[10], int digits[4]) {
+    for (int i = 0; i < 4; i++) {
+        int value = decode_code_ean8(&data[i * EAN8_CODE_LENGTH], codes);
+        if (value == -1) return false;
+
+        digits[i] = value;
+    }
+
+    return true;
 }
 
 int* decode_left_set_ean8(const SegmentEAN* segment) {
@@ -155,15 +652,9 @@ int* decode_left_set_ean8(const SegmentEAN* segment) {
     int* result = malloc(4 * sizeof(int));
     if (!result) return NULL;
 
-    for (int i = 0; i < 4; i++) {
-        int value = decode_code_ean8(&segment->data[segment->start + 3 + i * EAN8_CODE_LENGTH], L_CODE);
-
-        if (value == -1) {
-            free(result);
-            return NULL;
-        }
-
-        result[i] = value;
+    if (!decode_set_ean8(&segment->data[segment->start + 3], L_CODE, result)) {
+        free(result);
+        return NULL;
     }
 
     return result;
@@ -175,15 +666,9 @@ int* decode_right_set_ean8(const SegmentEAN* segment) {
     int* result = malloc(4 * sizeof(int));
     if (!result) return NULL;
 
-    for (int i = 0; i < 4; i++) {
-        int value = decode_code_ean8(&segment->data[segment->middle + 5 + i * EAN8_CODE_LENGTH], R_CODE);
-
-        if (value == -1) {
-            free(result);
-            return NULL;
-        }
-
-        result[i] = value;
+    if (!decode_set_ean8(&segment->data[segment->middle + 5], R_CODE, result)) {
+        free(result);
+        return NULL;
     }
 
     return result;
@@ -226,3 +711,258 @@ int* decode_ean8(const SegmentEAN* segment, EAN8Error* perror) { // TODO: update
 
     return result;
 }
+
+static inline const uint8_t* segment_code_ean8(const EAN8Segment* segment, size_t digit) {
+    if (digit < 4) return &segment->data[3 + digit * EAN8_CODE_LENGTH];
+    return &segment->data[3 + EAN8_SET_LENGTH + 5 + (digit - 4) * EAN8_CODE_LENGTH];
+}
+
+// 7-bit value of a character read in the opposite direction
+static inline int reverse_code(int value) {
+    int reversed = 0;
+    for (size_t i = 0; i < EAN8_CODE_LENGTH; i++) {
+        reversed = (reversed << 1) | (value & 1);
+        value >>= 1;
+    }
+    return reversed;
+}
+
+// fills a single unreadable digit from the check digit, if its pattern is
+// close enough to the sampled modules to be the same character
+static bool recover_erasure_ean8(const int values[EAN8_DIGIT_COUNT], int digits[EAN8_DIGIT_COUNT], EAN8Result* result) {
+    size_t missing = EAN8_DIGIT_COUNT;
+
+    for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) {
+        if (digits[i] >= 0) continue;
+        if (missing != EAN8_DIGIT_COUNT) return false;
+        missing = i;
+    }
+    if (missing == EAN8_DIGIT_COUNT) return false;
+
+    int digit = solve_check_digit(digits, EAN8_DIGIT_COUNT, missing);
+    int expected = missing < 4 ? L_CODE[digit] : R_CODE[digit];
+
+    if (__builtin_popcount((unsigned)(values[missing] ^ expected)) > EAN8_ERASURE_MAX_DISTANCE) {
+        return false;
+    }
+
+    result->digits[missing] = (uint8_t)digit;
+    result->recovered = true;
+    result->confidence = 0;
+    return true;
+}
+
+EAN8Error decode_segment_ean8(const EAN8Segment* segment, EAN8Result* result) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    result->recovered = false;
+    result->confidence = 0;
+    if (!segment) return result->status;
+
+    // guards are symmetric: read right to left, the first half holds
+    // bit-reversed R patterns and the second bit-reversed L patterns
+    EANCodeEntry entries[EAN8_DIGIT_COUNT];
+    int forward = 0, backward = 0;
+
+    for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) {
+        entries[i] = lookup_code_ean(segment_code_ean8(segment, i));
+        forward += entries[i].set == (i < 4 ? EAN_SET_L : EAN_SET_R);
+        backward += entries[i].reversed_set == (i < 4 ? EAN_SET_R : EAN_SET_L);
+    }
+
+    bool reversed = backward > forward;
+
+    int values[EAN8_DIGIT_COUNT];
+    int digits[EAN8_DIGIT_COUNT];
+    bool complete = true;
+    int confidence = EAN8_CONFIDENCE_EXACT;
+
+    // every character is read, a partial result still feeds digit voting
+    for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) {
+        size_t k = reversed ? EAN8_DIGIT_COUNT - 1 - i : i;
+        EANCodeSet set = i < 4 ? EAN_SET_L : EAN_SET_R;
+
+        // exact patterns are the common case, a table lookup away
+        if (!reversed && entries[k].set == set) digits[i] = entries[k].digit;
+        else if (reversed && entries[k].reversed_set == set) digits[i] = entries[k].reversed_digit;
+        else digits[i] = -1;
+
+        int value = fold_code(segment_code_ean8(segment, k));
+        values[i] = reversed ? reverse_code(value) : value;
+
+        if (digits[i] >= 0) {
+            result->digits[i] = (uint8_t)digits[i];
+            continue;
+        }
+
+        EANCodeMatch match = match_value_ean(values[i], EAN_SET_MASK(set));
+
+        // a tie with another digit leaves the character unread
+        if (match.distance > EAN8_MATCH_MAX_DISTANCE || match.margin == 0) {
+            result->digits[i] = EAN8_DIGIT_UNKNOWN;
+            complete = false;
+            continue;
+        }
+
+        digits[i] = match.digit;
+        result->digits[i] = match.digit;
+        if ((int)match.margin - match.distance < confidence) confidence = (int)match.margin - match.distance;
+    }
+
+    result->confidence = (uint8_t)(confidence < 0 ? 0 : confidence);
+
+    if (!complete) {
+        // nothing is left to confirm the characters matched within a module:
+        // past one of them, noise reads as a barcode as often as not
+        int exact = reversed ? backward : forward;
+        bool trusted = exact >= EAN8_DIGIT_COUNT - 2;
+        result->status = trusted && recover_erasure_ean8(values, digits, result) ? EAN8_ERROR_NONE : EAN8_ERROR_INVALID_DECODE;
+        return result->status;
+    }
+
+    int check_digit = compute_check_digit(digits, EAN8_DIGIT_COUNT);
+    result->status = check_digit == digits[7] ? EAN8_ERROR_NONE : EAN8_ERROR_INVALID_CHECKSUM;
+
+    return result->status;
+}
+
+// digit of an L/R character by its rounded edge distances [t1 - 2][t2 - 2],
+// -1 for pairs no character has; (3, 3) and (4, 4) are 2/8 and 1/7
+static const int8_t EDGE_DIGIT[4][4] = {
+    {  6, -1,  4, -1 },
+    { -1,  2, -1,  5 },
+    {  9, -1,  1, -1 },
+    { -1,  0, -1,  3 },
+};
+
+// rounds a distance to modules of a character 7 modules wide spanning `width`
+static inline size_t edge_modules(size_t distance, size_t width) {
+    return (14 * distance + width) / (2 * width);
+}
+
+// whether a run is one module of a window of `span` pixels (67 modules), within half a module
+static inline bool is_guard_run(const Run* run, size_t span) {
+    size_t scaled = 2 * EAN8_LENGTH * run->length;
+    return scaled >= span && scaled <= 3 * span;
+}
+
+static bool is_guard_runs(const Run* runs, size_t count, size_t span) {
+    for (size_t i = 0; i < count; i++) {
+        if (!is_guard_run(&runs[i], span)) return false;
+    }
+    return true;
+}
+
+// decodes the 4 runs of an L or R character, L and R sharing their run widths
+static int decode_edges_ean8(const Run* runs, size_t span) {
+    size_t width = runs[0].length + runs[1].length + runs[2].length + runs[3].length;
+
+    // a character is 7 modules, reject anything outside 5.5 to 8.5
+    size_t scaled = 2 * EAN8_LENGTH * width;
+    if (scaled < 11 * span || scaled > 17 * span) return -1;
+
+    size_t t1 = edge_modules(runs[0].length + runs[1].length, width);
+    size_t t2 = edge_modules(runs[1].length + runs[2].length, width);
+    if (t1 < 2 || t1 > 5 || t2 < 2 || t2 > 5) return -1;
+
+    int digit = EDGE_DIGIT[t1 - 2][t2 - 2];
+
+    // 1 and 2 have 3 modules of bars in the L set, 7 and 8 have 5
+    if (t1 == t2 && (t1 == 3 || t1 == 4) && edge_modules(runs[1].length + runs[3].length, width) >= 4) {
+        digit += 6;
+    }
+
+    return digit;
+}
+
+// read right to left, the first half holds bit-reversed R characters, with
+// 2 or 4 modules of bars where L characters have 3 or 5
+static bool is_reversed_window(const Run* runs) {
+    int backward = 0;
+
+    for (size_t i = 0; i < 4; i++) {
+        const Run* character = &runs[3 + i * 4];
+        size_t width = character[0].length + character[1].length + character[2].length + character[3].length;
+        backward += edge_modules(character[1].length + character[3].length, width) % 2 == 0;
+    }
+
+    return backward > 2;
+}
+
+static EAN8Error decode_window_edges_ean8(const Run* runs, EAN8Result* result) {
+    size_t span = 0;
+    for (size_t i = 0; i < EAN8_RUN_COUNT; i++) span += runs[i].length;
+
+    const Run* middle = &runs[3 + 4 * 4];
+    const Run* end = &runs[EAN8_RUN_COUNT - 3];
+
+    if (!is_guard_runs(runs, 3, span) || !is_guard_runs(middle, 5, span) || !is_guard_runs(end, 3, span)) {
+        return EAN8_ERROR_INVALID_FORMAT;
+    }
+
+    // guards are symmetric, a window read right to left is decoded from its last run
+    Run flipped[EAN8_WINDOW_RUNS];
+    if (is_reversed_window(runs)) {
+        for (size_t i = 0; i < EAN8_RUN_COUNT; i++) flipped[i] = runs[EAN8_RUN_COUNT - 1 - i];
+        runs = flipped;
+        middle = &runs[3 + 4 * 4];
+    }
+
+    int digits[EAN8_DIGIT_COUNT];
+    bool complete = true;
+
+    // no module bits to confirm a recovered digit against, nor to measure a margin
+    result->recovered = false;
+    result->confidence = EAN8_CONFIDENCE_EXACT;
+
+    for (size_t i = 0; i < 4; i++) {
+        digits[i] = decode_edges_ean8(&runs[3 + i * 4], span);
+        digits[i + 4] = decode_edges_ean8(&middle[5 + i * 4], span);
+    }
+
+    for (size_t i = 0; i < EAN8_DIGIT_COUNT; i++) {
+        result->digits[i] = digits[i] < 0 ? EAN8_DIGIT_UNKNOWN : (uint8_t)digits[i];
+        complete = complete && digits[i] >= 0;
+    }
+
+    if (!complete) return EAN8_ERROR_INVALID_DECODE;
+
+    int check_digit = compute_check_digit(digits, EAN8_DIGIT_COUNT);
+    return check_digit == digits[7] ? EAN8_ERROR_NONE : EAN8_ERROR_INVALID_CHECKSUM;
+}
+
+EAN8Error decode_scanline_edges_ean8(const Scanline* scanline, EAN8Result* result, size_t* prun) {
+    return decode_scanline_edges_ean8_from(scanline, 0, result, prun);
+}
+
+EAN8Error decode_scanline_edges_ean8_from(const Scanline* scanline, size_t from, EAN8Result* result, size_t* prun) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    result->recovered = false;
+    result->confidence = 0;
+    if (!scanline) return result->status;
+
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+
+    // keep the window that got furthest, a checksum failure over a decode failure
+    EAN8Result window;
+
+    for (size_t i = from; i + EAN8_RUN_COUNT <= scanline->count; i++) {
+        if (scanline->runs[i].color != 1) continue;
+
+        window.status = decode_window_edges_ean8(&scanline->runs[i], &window);
+
+        if (window.status == EAN8_ERROR_NONE ||
+            (window.status == EAN8_ERROR_INVALID_CHECKSUM && result->status != EAN8_ERROR_INVALID_CHECKSUM) ||
+            (window.status == EAN8_ERROR_INVALID_DECODE && result->status == EAN8_ERROR_INVALID_FORMAT)) {
+            *result = window;
+            if (prun) *prun = i;
+        }
+
+        if (result->status == EAN8_ERROR_NONE) break;
+    }
+
+    return result->status;
+}
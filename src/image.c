@@ -1,4 +1,6 @@
 #include "image.h"
+#include "bitplane.h"
+#include "image_kernels.h"
 #include <stdlib.h>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -60,10 +62,12 @@ int otsu_threshold(const uint8_t* gray, int length) {
     int histogram[256] = {0};
 
     // compute grey scale histogram
-    for (int i = 0; i < length; i++) {
-        histogram[gray[i]]++;
-    }
+    if (length > 0) histogram_u8(gray, (size_t)length, histogram);
+
+    return otsu_threshold_histogram(histogram, length);
+}
 
+int otsu_threshold_histogram(const int histogram[256], int length) {
     long long sum_total = 0;
     for (int i = 0; i < 256; i++) {
         sum_total += i * histogram[i];
@@ -90,7 +94,7 @@ int otsu_threshold(const uint8_t* gray, int length) {
         meanF = sumF / wF;
 
         // calculate inter-class variance
-        double var = wB * wF * (meanB - meanF) * (meanB - meanF);
+        double var = (double)wB * wF * (meanB - meanF) * (meanB - meanF);
 
         if (var > maxInterVar) {
             maxInterVar = var;
@@ -101,6 +105,55 @@ int otsu_threshold(const uint8_t* gray, int length) {
     return best_threshold;
 }
 
+int otsu_threshold_subsampled(const Image* image, int step) {
+    if (!image || !image->data || image->channels != 1 || step <= 0) return 0;
+
+    int histogram[256] = {0};
+    int count = 0;
+
+    for (int y = 0; y < image->height; y += step) {
+        const uint8_t* row = &image->data[(size_t)y * image->width];
+        for (int x = 0; x < image->width; x += step) {
+            histogram[row[x]]++;
+            count++;
+        }
+    }
+
+    return otsu_threshold_histogram(histogram, count);
+}
+
+// black/white transitions among `count` pixels `step` bytes apart
+static size_t count_transitions(const uint8_t* pixels, size_t count, size_t step, int threshold) {
+    size_t transitions = 0;
+    bool black = pixels[0] <= threshold;
+
+    for (size_t i = 1; i < count; i++) {
+        bool current = pixels[i * step] <= threshold;
+        transitions += current != black;
+        black = current;
+    }
+
+    return transitions;
+}
+
+ImageOrientation detect_orientation(const Image* gray, int threshold, int samples) {
+    if (!gray || !gray->data || gray->channels != 1 || samples <= 0) return ORIENTATION_HORIZONTAL;
+
+    size_t width = gray->width, height = gray->height;
+    size_t row_transitions = 0, column_transitions = 0;
+
+    for (int i = 0; i < samples; i++) {
+        size_t y = (i + 1) * height / (samples + 1);
+        size_t x = (i + 1) * width / (samples + 1);
+
+        row_transitions += count_transitions(&gray->data[y * width], width, 1, threshold);
+        column_transitions += count_transitions(&gray->data[x], height, width, threshold);
+    }
+
+    // compare densities: column_transitions / height > row_transitions / width
+    return column_transitions * width > row_transitions * height ? ORIENTATION_VERTICAL : ORIENTATION_HORIZONTAL;
+}
+
 void binarization(Image* image, int threshold) {
     if (!image) return;
 
@@ -109,9 +162,86 @@ void binarization(Image* image, int threshold) {
         return;
     }
 
-    for (int i = 0; i < image->width * image->height * image->channels; i++) {
-        image->data[i] = image->data[i] > threshold ? 255 : 0;
+    size_t length = (size_t)image->width * image->height * image->channels;
+    threshold_u8(image->data, image->data, length, threshold);
+}
+
+void default_binarization_options(BinarizationOptions* options) {
+    if (!options) return;
+
+    options->method = BINARIZATION_GLOBAL;
+    options->threshold = -1;
+    options->window = 0;
+    options->sensitivity = 15;
+}
+
+bool binarization_with_options(Image* image, const BinarizationOptions* options) {
+    if (!image || !image->data || image->channels != 1) return false;
+
+    BinarizationOptions defaults;
+    if (!options) {
+        default_binarization_options(&defaults);
+        options = &defaults;
+    }
+
+    if (options->method == BINARIZATION_GLOBAL) {
+        int threshold = options->threshold;
+        if (threshold < 0) threshold = otsu_threshold(image->data, image->width * image->height);
+
+        binarization(image, threshold);
+        return true;
+    }
+
+    // window sums need the original pixels: classify into bits first
+    BitPlane* plane = create_bitplane(image->width, image->height);
+    if (!plane) return false;
+
+    if (!binarize_bitplane_with_options(image, options, plane)) {
+        destroy_bitplane(plane);
+        return false;
+    }
+
+    for (int y = 0; y < image->height; y++) {
+        uint8_t* row = &image->data[(size_t)y * image->width];
+        for (int x = 0; x < image->width; x++) {
+            row[x] = bitplane_get(plane, x, y) ? 0 : 255;
+        }
+    }
+
+    destroy_bitplane(plane);
+    return true;
+}
+
+void rgb_to_grayscale(Image* image) {
+    rgb_to_grayscale_histogram(image, NULL);
+}
+
+void rgb_to_grayscale_histogram(Image* image, int histogram[256]) {
+    if (!image || !image->data) return;
+
+    if (image->channels < 1 || image->channels > 4) {
+        fprintf(stderr, "rgb_to_grayscale: unsupported number of channels\n");
+        return;
     }
+
+    size_t n_pixels = (size_t)image->width * image->height;
+
+    // luma is written in place: pixel i never overtakes the source pixel i
+    rgb_to_luma_u8(image->data, image->data, n_pixels, image->channels, histogram);
+    image->channels = 1;
+}
+
+int rgb_to_grayscale_otsu(Image* image, int step) {
+    if (!image || !image->data) return 0;
+
+    // a gray image has no conversion pass to count in, a subsample is cheaper
+    if (image->channels == 1) return otsu_threshold_subsampled(image, step);
+
+    int histogram[256] = {0};
+    rgb_to_grayscale_histogram(image, histogram);
+    if (image->channels != 1) return 0;
+
+    return otsu_threshold_histogram(histogram, image->width * image->height);
 }
 
 void save_image_png(Image* image, const char* filename) {
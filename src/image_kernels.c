@@ -0,0 +1,480 @@
+#include "image_kernels.h"
+#include "cpu_features.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMAGE_KERNELS_X86 1
+#endif
+
+// BT.601 luma weights in 7-bit fixed point (sum 128, each fits a signed byte)
+#define LUMA_R 38
+#define LUMA_G 75
+#define LUMA_B 15
+#define LUMA_SHIFT 7
+
+// four interleaved sub-histograms, see histogram_u8()
+typedef struct {
+    int counts[4][256];
+} SubHistogram;
+
+static inline void count_pixels(SubHistogram* sub, const uint8_t* pixels, size_t length) {
+    size_t i = 0;
+
+    // 8 pixels per load, spread over the four sub-histograms
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, &pixels[i], sizeof(word));
+
+        sub->counts[0][word & 0xFF]++;
+        sub->counts[1][(word >> 8) & 0xFF]++;
+        sub->counts[2][(word >> 16) & 0xFF]++;
+        sub->counts[3][(word >> 24) & 0xFF]++;
+        sub->counts[0][(word >> 32) & 0xFF]++;
+        sub->counts[1][(word >> 40) & 0xFF]++;
+        sub->counts[2][(word >> 48) & 0xFF]++;
+        sub->counts[3][word >> 56]++;
+    }
+
+    for (; i < length; i++) {
+        sub->counts[0][pixels[i]]++;
+    }
+}
+
+static void merge_histogram(const SubHistogram* sub, int histogram[256]) {
+    for (int v = 0; v < 256; v++) {
+        histogram[v] += sub->counts[0][v] + sub->counts[1][v] + sub->counts[2][v] + sub->counts[3][v];
+    }
+}
+
+void histogram_u8(const uint8_t* pixels, size_t length, int histogram[256]) {
+    SubHistogram sub;
+    memset(&sub, 0, sizeof(sub));
+
+    count_pixels(&sub, pixels, length);
+    merge_histogram(&sub, histogram);
+}
+
+static void threshold_u8_scalar(const uint8_t* src, uint8_t* dst, size_t length, int threshold) {
+    for (size_t i = 0; i < length; i++) {
+        dst[i] = src[i] > threshold ? 255 : 0;
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+// x > t  <=>  max(x, t + 1) == x, with t + 1 in [1, 255]
+__attribute__((target("sse2")))
+static void threshold_u8_sse2(const uint8_t* src, uint8_t* dst, size_t length, int threshold) {
+    __m128i limit = _mm_set1_epi8((char)(threshold + 1));
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)&src[i]);
+        __m128i above = _mm_cmpeq_epi8(_mm_max_epu8(x, limit), x);
+        _mm_storeu_si128((__m128i*)&dst[i], above);
+    }
+
+    threshold_u8_scalar(&src[i], &dst[i], length - i, threshold);
+}
+
+__attribute__((target("avx2")))
+static void threshold_u8_avx2(const uint8_t* src, uint8_t* dst, size_t length, int threshold) {
+    __m256i limit = _mm256_set1_epi8((char)(threshold + 1));
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&src[i]);
+        __m256i above = _mm256_cmpeq_epi8(_mm256_max_epu8(x, limit), x);
+        _mm256_storeu_si256((__m256i*)&dst[i], above);
+    }
+
+    threshold_u8_scalar(&src[i], &dst[i], length - i, threshold);
+}
+#endif
+
+void threshold_u8(const uint8_t* src, uint8_t* dst, size_t length, int threshold) {
+    if (threshold < 0) {
+        memset(dst, 255, length);
+        return;
+    }
+    if (threshold >= 255) {
+        memset(dst, 0, length);
+        return;
+    }
+
+#ifdef IMAGE_KERNELS_X86
+    unsigned features = cpu_features();
+    if (features & CPU_FEATURE_AVX2) {
+        threshold_u8_avx2(src, dst, length, threshold);
+        return;
+    }
+    if (features & CPU_FEATURE_SSE2) {
+        threshold_u8_sse2(src, dst, length, threshold);
+        return;
+    }
+#endif
+
+    threshold_u8_scalar(src, dst, length, threshold);
+}
+
+static void rgb_to_luma_scalar(const uint8_t* src, uint8_t* dst, size_t n_pixels, int channels) {
+    if (channels < 3) {
+        // gray (+ alpha): keep the gray value
+        for (size_t i = 0; i < n_pixels; i++) {
+            dst[i] = src[i * channels];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < n_pixels; i++) {
+        const uint8_t* p = &src[i * channels];
+        dst[i] = (uint8_t)((LUMA_R * p[0] + LUMA_G * p[1] + LUMA_B * p[2] + (1 << (LUMA_SHIFT - 1))) >> LUMA_SHIFT);
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+// 4 pixels (shuffled to R G B 0) -> 4 x int32 luma before rounding
+__attribute__((target("ssse3")))
+static inline __m128i luma_sums_ssse3(__m128i pixels, __m128i shuffle, __m128i weights) {
+    __m128i rgb0 = _mm_shuffle_epi8(pixels, shuffle);
+    __m128i pairs = _mm_maddubs_epi16(rgb0, weights);
+    return _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+}
+
+// converts 16 pixels per step; returns the number of pixels converted
+__attribute__((target("ssse3")))
+static size_t rgb_to_luma_ssse3(const uint8_t* src, uint8_t* dst, size_t n_pixels, int channels, SubHistogram* sub) {
+    // 16-byte loads of 4 pixels: RGB loads read 4 bytes past the 12 they use
+    size_t stride = (size_t)channels * 4;
+    __m128i shuffle = channels == 4
+        ? _mm_setr_epi8(0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1)
+        : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i weights = _mm_setr_epi8(LUMA_R, LUMA_G, LUMA_B, 0, LUMA_R, LUMA_G, LUMA_B, 0,
+                                    LUMA_R, LUMA_G, LUMA_B, 0, LUMA_R, LUMA_G, LUMA_B, 0);
+    __m128i round = _mm_set1_epi32(1 << (LUMA_SHIFT - 1));
+
+    size_t i = 0;
+    for (; (i + 16) * channels + (channels == 3 ? 4 : 0) <= n_pixels * channels; i += 16) {
+        const uint8_t* p = &src[i * channels];
+
+        __m128i s0 = luma_sums_ssse3(_mm_loadu_si128((const __m128i*)p), shuffle, weights);
+        __m128i s1 = luma_sums_ssse3(_mm_loadu_si128((const __m128i*)(p + stride)), shuffle, weights);
+        __m128i s2 = luma_sums_ssse3(_mm_loadu_si128((const __m128i*)(p + 2 * stride)), shuffle, weights);
+        __m128i s3 = luma_sums_ssse3(_mm_loadu_si128((const __m128i*)(p + 3 * stride)), shuffle, weights);
+
+        s0 = _mm_srli_epi32(_mm_add_epi32(s0, round), LUMA_SHIFT);
+        s1 = _mm_srli_epi32(_mm_add_epi32(s1, round), LUMA_SHIFT);
+        s2 = _mm_srli_epi32(_mm_add_epi32(s2, round), LUMA_SHIFT);
+        s3 = _mm_srli_epi32(_mm_add_epi32(s3, round), LUMA_SHIFT);
+
+        __m128i luma = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+        _mm_storeu_si128((__m128i*)&dst[i], luma);
+
+        if (sub) count_pixels(sub, &dst[i], 16);
+    }
+
+    return i;
+}
+
+// converts 32 RGBA pixels per step; returns the number of pixels converted
+__attribute__((target("avx2")))
+static size_t rgba_to_luma_avx2(const uint8_t* src, uint8_t* dst, size_t n_pixels, SubHistogram* sub) {
+    __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1,
+                                       0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1);
+    __m256i weights = _mm256_set1_epi32(LUMA_R | (LUMA_G << 8) | (LUMA_B << 16));
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i round = _mm256_set1_epi32(1 << (LUMA_SHIFT - 1));
+    // packs/packus interleave the 128-bit lanes: put the 4-pixel groups back in order
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 32 <= n_pixels; i += 32) {
+        const __m256i* p = (const __m256i*)&src[i * 4];
+        __m256i s[4];
+
+        for (int k = 0; k < 4; k++) {
+            __m256i rgb0 = _mm256_shuffle_epi8(_mm256_loadu_si256(p + k), shuffle);
+            __m256i sums = _mm256_madd_epi16(_mm256_maddubs_epi16(rgb0, weights), ones);
+            s[k] = _mm256_srli_epi32(_mm256_add_epi32(sums, round), LUMA_SHIFT);
+        }
+
+        __m256i luma = _mm256_packus_epi16(_mm256_packs_epi32(s[0], s[1]), _mm256_packs_epi32(s[2], s[3]));
+        luma = _mm256_permutevar8x32_epi32(luma, order);
+        _mm256_storeu_si256((__m256i*)&dst[i], luma);
+
+        if (sub) count_pixels(sub, &dst[i], 32);
+    }
+
+    return i;
+}
+#endif
+
+void rgb_to_luma_u8(const uint8_t* src, uint8_t* dst, size_t n_pixels, int channels, int histogram[256]) {
+    if (channels == 1) {
+        if (dst != src) memmove(dst, src, n_pixels);
+        if (histogram) histogram_u8(dst, n_pixels, histogram);
+        return;
+    }
+
+    SubHistogram sub;
+    if (histogram) memset(&sub, 0, sizeof(sub));
+
+    size_t done = 0;
+
+#ifdef IMAGE_KERNELS_X86
+    unsigned features = cpu_features();
+    if (channels == 4 && (features & CPU_FEATURE_AVX2)) {
+        done = rgba_to_luma_avx2(src, dst, n_pixels, histogram ? &sub : NULL);
+    } else if (channels >= 3 && (features & CPU_FEATURE_SSSE3)) {
+        done = rgb_to_luma_ssse3(src, dst, n_pixels, channels, histogram ? &sub : NULL);
+    }
+#endif
+
+    rgb_to_luma_scalar(&src[done * channels], &dst[done], n_pixels - done, channels);
+
+    if (histogram) {
+        count_pixels(&sub, &dst[done], n_pixels - done);
+        merge_histogram(&sub, histogram);
+    }
+}
+
+static void threshold_pack_u8_scalar(const uint8_t* src, size_t length, int threshold, uint64_t* bits) {
+    for (size_t w = 0; w * 64 < length; w++) {
+        size_t count = length - w * 64 < 64 ? length - w * 64 : 64;
+        uint64_t word = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            word |= (uint64_t)(src[w * 64 + i] <= threshold) << i;
+        }
+
+        bits[w] = word;
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+__attribute__((target("sse2")))
+static size_t threshold_pack_u8_sse2(const uint8_t* src, size_t length, int threshold, uint64_t* bits) {
+    __m128i limit = _mm_set1_epi8((char)(threshold + 1));
+
+    size_t w = 0;
+    for (; (w + 1) * 64 <= length; w++) {
+        uint64_t word = 0;
+
+        for (int k = 0; k < 4; k++) {
+            __m128i x = _mm_loadu_si128((const __m128i*)&src[w * 64 + k * 16]);
+            uint32_t above = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, limit), x));
+            word |= (uint64_t)(~above & 0xFFFF) << (k * 16);
+        }
+
+        bits[w] = word;
+    }
+
+    return w;
+}
+
+__attribute__((target("avx2")))
+static size_t threshold_pack_u8_avx2(const uint8_t* src, size_t length, int threshold, uint64_t* bits) {
+    __m256i limit = _mm256_set1_epi8((char)(threshold + 1));
+
+    size_t w = 0;
+    for (; (w + 1) * 64 <= length; w++) {
+        __m256i low = _mm256_loadu_si256((const __m256i*)&src[w * 64]);
+        __m256i high = _mm256_loadu_si256((const __m256i*)&src[w * 64 + 32]);
+
+        uint32_t above_low = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(low, limit), low));
+        uint32_t above_high = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(high, limit), high));
+
+        bits[w] = ~((uint64_t)above_high << 32 | above_low);
+    }
+
+    return w;
+}
+#endif
+
+void threshold_pack_u8(const uint8_t* src, size_t length, int threshold, uint64_t* bits) {
+    size_t n_words = (length + 63) / 64;
+
+    if (threshold < 0 || threshold >= 255) {
+        // everything white, or everything black
+        memset(bits, threshold < 0 ? 0 : 0xFF, n_words * sizeof(uint64_t));
+        if (length % 64) bits[n_words - 1] &= (UINT64_C(1) << (length % 64)) - 1;
+        return;
+    }
+
+    size_t done = 0;
+
+#ifdef IMAGE_KERNELS_X86
+    unsigned features = cpu_features();
+    if (features & CPU_FEATURE_AVX2) {
+        done = threshold_pack_u8_avx2(src, length, threshold, bits);
+    } else if (features & CPU_FEATURE_SSE2) {
+        done = threshold_pack_u8_sse2(src, length, threshold, bits);
+    }
+#endif
+
+    threshold_pack_u8_scalar(&src[done * 64], length - done * 64, threshold, &bits[done]);
+}
+
+// square blocks small enough for the source and destination rows to stay in L1
+#define TRANSPOSE_BLOCK 64
+
+static void transpose_u8_scalar(const uint8_t* src, size_t src_stride, size_t width, size_t height, uint8_t* dst, size_t dst_stride) {
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            dst[x * dst_stride + y] = src[y * src_stride + x];
+        }
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+// 16x16 bytes: four rounds of interleaving row i with row i + 8 perform the transpose
+__attribute__((target("sse2")))
+static inline void transpose_tile_sse2(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+    __m128i rows[16], next[16];
+
+    for (int i = 0; i < 16; i++) rows[i] = _mm_loadu_si128((const __m128i*)&src[i * src_stride]);
+
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 8; i++) {
+            next[2 * i] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+            next[2 * i + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+        }
+        memcpy(rows, next, sizeof(rows));
+    }
+
+    for (int i = 0; i < 16; i++) _mm_storeu_si128((__m128i*)&dst[i * dst_stride], rows[i]);
+}
+
+__attribute__((target("sse2")))
+static void transpose_u8_sse2(const uint8_t* src, size_t src_stride, size_t width, size_t height, uint8_t* dst, size_t dst_stride) {
+    size_t tiled_width = width & ~(size_t)15;
+    size_t tiled_height = height & ~(size_t)15;
+
+    for (size_t by = 0; by < tiled_height; by += TRANSPOSE_BLOCK) {
+        size_t block_height = tiled_height - by < TRANSPOSE_BLOCK ? tiled_height - by : TRANSPOSE_BLOCK;
+
+        for (size_t bx = 0; bx < tiled_width; bx += TRANSPOSE_BLOCK) {
+            size_t block_width = tiled_width - bx < TRANSPOSE_BLOCK ? tiled_width - bx : TRANSPOSE_BLOCK;
+
+            for (size_t y = by; y < by + block_height; y += 16) {
+                for (size_t x = bx; x < bx + block_width; x += 16) {
+                    transpose_tile_sse2(&src[y * src_stride + x], src_stride, &dst[x * dst_stride + y], dst_stride);
+                }
+            }
+        }
+    }
+
+    // right and bottom edges narrower than a tile
+    transpose_u8_scalar(&src[tiled_width], src_stride, width - tiled_width, height, &dst[tiled_width * dst_stride], dst_stride);
+    transpose_u8_scalar(&src[tiled_height * src_stride], src_stride, tiled_width, height - tiled_height, &dst[tiled_height], dst_stride);
+}
+#endif
+
+void transpose_u8(const uint8_t* src, size_t src_stride, size_t width, size_t height, uint8_t* dst, size_t dst_stride) {
+#ifdef IMAGE_KERNELS_X86
+    if (cpu_features() & CPU_FEATURE_SSE2) {
+        transpose_u8_sse2(src, src_stride, width, height, dst, dst_stride);
+        return;
+    }
+#endif
+
+    // same blocking without SIMD
+    for (size_t by = 0; by < height; by += TRANSPOSE_BLOCK) {
+        size_t block_height = height - by < TRANSPOSE_BLOCK ? height - by : TRANSPOSE_BLOCK;
+
+        for (size_t bx = 0; bx < width; bx += TRANSPOSE_BLOCK) {
+            size_t block_width = width - bx < TRANSPOSE_BLOCK ? width - bx : TRANSPOSE_BLOCK;
+            transpose_u8_scalar(&src[by * src_stride + bx], src_stride, block_width, block_height, &dst[bx * dst_stride + by], dst_stride);
+        }
+    }
+}
+
+static void downsample_2x_u8_scalar(const uint8_t* top, const uint8_t* bottom, uint8_t* dst, size_t length) {
+    for (size_t x = 0; x < length; x++) {
+        dst[x] = (uint8_t)((top[2 * x] + top[2 * x + 1] + bottom[2 * x] + bottom[2 * x + 1] + 2) >> 2);
+    }
+}
+
+#ifdef IMAGE_KERNELS_X86
+// sum of each pair of adjacent bytes, as 16-bit lanes
+__attribute__((target("sse2")))
+static inline __m128i pair_sums_sse2(__m128i x, __m128i low_bytes) {
+    return _mm_add_epi16(_mm_and_si128(x, low_bytes), _mm_srli_epi16(x, 8));
+}
+
+__attribute__((target("sse2")))
+static size_t downsample_2x_u8_sse2(const uint8_t* top, const uint8_t* bottom, uint8_t* dst, size_t length) {
+    __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    __m128i rounding = _mm_set1_epi16(2);
+
+    size_t x = 0;
+    for (; x + 16 <= length; x += 16) {
+        __m128i sums[2];
+
+        for (int k = 0; k < 2; k++) {
+            __m128i a = _mm_loadu_si128((const __m128i*)&top[2 * x + 16 * k]);
+            __m128i b = _mm_loadu_si128((const __m128i*)&bottom[2 * x + 16 * k]);
+            __m128i sum = _mm_add_epi16(pair_sums_sse2(a, low_bytes), pair_sums_sse2(b, low_bytes));
+            sums[k] = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+        }
+
+        _mm_storeu_si128((__m128i*)&dst[x], _mm_packus_epi16(sums[0], sums[1]));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pair_sums_avx2(__m256i x, __m256i low_bytes) {
+    return _mm256_add_epi16(_mm256_and_si256(x, low_bytes), _mm256_srli_epi16(x, 8));
+}
+
+__attribute__((target("avx2")))
+static size_t downsample_2x_u8_avx2(const uint8_t* top, const uint8_t* bottom, uint8_t* dst, size_t length) {
+    __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    __m256i rounding = _mm256_set1_epi16(2);
+
+    size_t x = 0;
+    for (; x + 32 <= length; x += 32) {
+        __m256i sums[2];
+
+        for (int k = 0; k < 2; k++) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)&top[2 * x + 32 * k]);
+            __m256i b = _mm256_loadu_si256((const __m256i*)&bottom[2 * x + 32 * k]);
+            __m256i sum = _mm256_add_epi16(pair_sums_avx2(a, low_bytes), pair_sums_avx2(b, low_bytes));
+            sums[k] = _mm256_srli_epi16(_mm256_add_epi16(sum, rounding), 2);
+        }
+
+        // packus works within 128-bit lanes, reorder the quadwords
+        __m256i packed = _mm256_packus_epi16(sums[0], sums[1]);
+        _mm256_storeu_si256((__m256i*)&dst[x], _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+
+    return x;
+}
+#endif
+
+void downsample_2x_u8(const uint8_t* src, size_t src_stride, size_t width, size_t height, uint8_t* dst, size_t dst_stride) {
+    size_t length = width / 2;
+
+#ifdef IMAGE_KERNELS_X86
+    unsigned features = cpu_features();
+#endif
+
+    for (size_t y = 0; y < height / 2; y++) {
+        const uint8_t* top = &src[2 * y * src_stride];
+        const uint8_t* bottom = top + src_stride;
+        uint8_t* row = &dst[y * dst_stride];
+        size_t done = 0;
+
+#ifdef IMAGE_KERNELS_X86
+        if (features & CPU_FEATURE_AVX2) {
+            done = downsample_2x_u8_avx2(top, bottom, row, length);
+        } else if (features & CPU_FEATURE_SSE2) {
+            done = downsample_2x_u8_sse2(top, bottom, row, length);
+        }
+#endif
+
+        downsample_2x_u8_scalar(&top[2 * done], &bottom[2 * done], &row[done], length - done);
+    }
+}
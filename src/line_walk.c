@@ -0,0 +1,156 @@
+#include "line_walk.h"
+#include <math.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// a half-line from anywhere in the image leaves it within max(width, height) steps
+static size_t walk_length(int width, int height) {
+    return (size_t)(width > height ? width : height);
+}
+
+static void fill_line_walk(LineWalk* walk, int width, int height, int angle) {
+    double radians = angle * M_PI / 180.0;
+    double c = cos(radians), s = sin(radians);
+
+    // one pixel per step on the major axis
+    double scale = fabs(c) > fabs(s) ? fabs(c) : fabs(s);
+
+    walk->angle = angle;
+    walk->width = width;
+    walk->height = height;
+
+    for (size_t i = 0; i < walk->length; i++) {
+        double t = i / scale;
+        walk->dx[i] = (int)lround(t * c);
+        walk->dy[i] = (int)-lround(t * s);
+        walk->offsets[i] = (ptrdiff_t)walk->dy[i] * width + walk->dx[i];
+    }
+}
+
+static bool is_valid_walk(int width, int height, int angle) {
+    return width > 0 && height > 0 && angle > -90 && angle <= 90;
+}
+
+LineWalk* create_line_walk(int width, int height, int angle) {
+    if (!is_valid_walk(width, height, angle)) return NULL;
+
+    LineWalk* walk = malloc(sizeof(LineWalk));
+    if (!walk) return NULL;
+
+    walk->length = walk_length(width, height);
+    walk->dx = malloc(walk->length * sizeof(int));
+    walk->dy = malloc(walk->length * sizeof(int));
+    walk->offsets = malloc(walk->length * sizeof(ptrdiff_t));
+
+    if (!walk->dx || !walk->dy || !walk->offsets) {
+        destroy_line_walk(walk);
+        return NULL;
+    }
+
+    fill_line_walk(walk, width, height, angle);
+    return walk;
+}
+
+LineWalk* create_line_walk_ctx(LineVisionContext* context, int width, int height, int angle) {
+    if (!is_valid_walk(width, height, angle)) return NULL;
+
+    LineWalk* walk = linevision_context_alloc(context, sizeof(LineWalk));
+    if (!walk) return NULL;
+
+    walk->length = walk_length(width, height);
+    walk->dx = linevision_context_alloc(context, walk->length * sizeof(int));
+    walk->dy = linevision_context_alloc(context, walk->length * sizeof(int));
+    walk->offsets = linevision_context_alloc(context, walk->length * sizeof(ptrdiff_t));
+    if (!walk->dx || !walk->dy || !walk->offsets) return NULL;
+
+    fill_line_walk(walk, width, height, angle);
+    return walk;
+}
+
+void destroy_line_walk(LineWalk* walk) {
+    if (!walk) return;
+    free(walk->dx);
+    free(walk->dy);
+    free(walk->offsets);
+    free(walk);
+}
+
+size_t line_walk_capacity(const LineWalk* walk) {
+    return 2 * walk->length - 1;
+}
+
+static inline bool is_inside(const LineWalk* walk, int x, int y) {
+    return x >= 0 && x < walk->width && y >= 0 && y < walk->height;
+}
+
+// first step from (x, y) in direction `sign` that lands inside the image, 0 if none
+static size_t first_inside_step(const LineWalk* walk, int x, int y, int sign) {
+    for (size_t i = 1; i < walk->length; i++) {
+        if (is_inside(walk, x + sign * walk->dx[i], y + sign * walk->dy[i])) return i;
+    }
+    return 0;
+}
+
+bool line_walk_center(const LineWalk* walk, int offset, int* px, int* py, int* pshift) {
+    double radians = walk->angle * M_PI / 180.0;
+
+    // normal of the lines, pointing down for rows
+    int x = walk->width / 2 + (int)lround(offset * sin(radians));
+    int y = walk->height / 2 + (int)lround(offset * cos(radians));
+    int shift = 0;
+
+    // off-image foot: an oblique line can still cross a corner, clip it to the
+    // image (the crossing is on one side of the foot, within a half diagonal)
+    if (!is_inside(walk, x, y)) {
+        int sign = 1;
+        size_t step = first_inside_step(walk, x, y, sign);
+        if (step == 0) {
+            sign = -1;
+            step = first_inside_step(walk, x, y, sign);
+            if (step == 0) return false;
+        }
+
+        x += sign * walk->dx[step];
+        y += sign * walk->dy[step];
+        shift = sign * (int)step;
+    }
+
+    *px = x;
+    *py = y;
+    if (pshift) *pshift = shift;
+
+    return true;
+}
+
+// number of steps from (x, y) that stay inside the image, in direction `sign`
+static size_t half_line_steps(const LineWalk* walk, int x, int y, int sign) {
+    size_t low = 1, high = walk->length; // step 0 is inside, step `length` is not
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (is_inside(walk, x + sign * walk->dx[middle], y + sign * walk->dy[middle])) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+size_t sample_line_walk(const LineWalk* walk, const uint8_t* data, int x, int y, uint8_t* line, size_t* pcenter) {
+    const uint8_t* center = &data[(size_t)y * walk->width + x];
+
+    size_t backward = half_line_steps(walk, x, y, -1);
+    size_t forward = half_line_steps(walk, x, y, 1);
+    if (pcenter) *pcenter = backward - 1;
+
+    size_t count = 0;
+    for (size_t i = backward - 1; i > 0; i--) line[count++] = center[-walk->offsets[i]];
+    for (size_t i = 0; i < forward; i++) line[count++] = center[walk->offsets[i]];
+
+    return count;
+}
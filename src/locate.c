@@ -0,0 +1,286 @@
+#include "locate.h"
+#include "ean_patterns.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// cells on each side added to a region, for the quiet zones and the ends of the bars
+#define REGION_MARGIN 2
+// smallest component kept, in cells
+#define MIN_REGION_CELLS 6
+// the dominant gradient must be this many times the other one
+#define DOMINANCE 2
+// minimum mean gradient per sampled pixel of a candidate cell
+#define MIN_PIXEL_ENERGY 8
+// dominant cells of the same kind out of 9 for a cell to be kept
+#define MAJORITY 5
+
+enum { CELL_NONE = 0, CELL_HORIZONTAL = 1, CELL_VERTICAL = 2 };
+
+// scratch memory of one localization
+typedef struct {
+    int columns;
+    int rows;
+    uint32_t* dx;
+    uint32_t* dy;
+    uint8_t* kind;
+    uint8_t* mask;
+    int* queue;
+} EnergyMap;
+
+static size_t energy_map_cells(const Image* gray, int scale, int* columns, int* rows) {
+    *columns = (gray->width + scale - 1) / scale;
+    *rows = (gray->height + scale - 1) / scale;
+    return (size_t)*columns * *rows;
+}
+
+// gradient sums of two rows per cell for dx and of two columns per cell
+// for dy, at a quarter and three quarters of the cell, so that both
+// directions are sampled alike
+static void accumulate_energy(const Image* gray, int scale, EnergyMap* map) {
+    int width = gray->width;
+    int offsets[2] = { scale / 4, 3 * scale / 4 };
+
+    for (int cy = 0; cy < map->rows; cy++) {
+        uint32_t* dx = &map->dx[(size_t)cy * map->columns];
+        uint32_t* dy = &map->dy[(size_t)cy * map->columns];
+
+        for (int k = 0; k < 2; k++) {
+            int y = cy * scale + offsets[k];
+            if (y >= gray->height) continue;
+
+            const uint8_t* row = &gray->data[(size_t)y * width];
+            for (int cx = 0; cx < map->columns; cx++) {
+                int end = (cx + 1) * scale < width - 1 ? (cx + 1) * scale : width - 1;
+                uint32_t sum = 0;
+
+                for (int x = cx * scale; x < end; x++) sum += (uint32_t)abs((int)row[x + 1] - row[x]);
+                dx[cx] += sum;
+            }
+        }
+
+        for (int y = cy * scale; y < (cy + 1) * scale && y + 1 < gray->height; y++) {
+            const uint8_t* row = &gray->data[(size_t)y * width];
+            const uint8_t* below = row + width;
+
+            for (int cx = 0; cx < map->columns; cx++) {
+                for (int k = 0; k < 2; k++) {
+                    int x = cx * scale + offsets[k];
+                    if (x < width) dy[cx] += (uint32_t)abs((int)below[x] - row[x]);
+                }
+            }
+        }
+    }
+}
+
+static void classify_cells(const EnergyMap* map, int scale) {
+    size_t n_cells = (size_t)map->columns * map->rows;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < n_cells; i++) total += map->dx[i] > map->dy[i] ? map->dx[i] : map->dy[i];
+
+    // above the image mean and above an absolute floor for flat images
+    uint64_t floor = (uint64_t)MIN_PIXEL_ENERGY * 2 * scale;
+    uint64_t mean = total / n_cells;
+    uint64_t minimum = mean > floor ? mean : floor;
+
+    for (size_t i = 0; i < n_cells; i++) {
+        uint32_t dx = map->dx[i], dy = map->dy[i];
+
+        map->kind[i] = CELL_NONE;
+        if (dx >= minimum && dx >= DOMINANCE * (uint64_t)dy) map->kind[i] = CELL_HORIZONTAL;
+        if (dy >= minimum && dy >= DOMINANCE * (uint64_t)dx) map->kind[i] = CELL_VERTICAL;
+    }
+}
+
+// 3x3 majority filter: a barcode is a solid block of dominant cells, while
+// text, texture and the edges of boxes only give scattered or thin ones
+static void filter_cells(const EnergyMap* map) {
+    for (int cy = 0; cy < map->rows; cy++) {
+        int top = cy > 0 ? cy - 1 : 0, bottom = cy + 1 < map->rows ? cy + 1 : cy;
+
+        for (int cx = 0; cx < map->columns; cx++) {
+            int left = cx > 0 ? cx - 1 : 0, right = cx + 1 < map->columns ? cx + 1 : cx;
+            int counts[3] = { 0, 0, 0 };
+
+            for (int y = top; y <= bottom; y++) {
+                const uint8_t* cells = &map->kind[(size_t)y * map->columns];
+                for (int x = left; x <= right; x++) counts[cells[x]]++;
+            }
+
+            uint8_t kind = CELL_NONE;
+            if (counts[CELL_HORIZONTAL] >= MAJORITY) kind = CELL_HORIZONTAL;
+            else if (counts[CELL_VERTICAL] >= MAJORITY) kind = CELL_VERTICAL;
+
+            map->mask[(size_t)cy * map->columns + cx] = kind;
+        }
+    }
+}
+
+// 3x3 dilation, closing the gaps left by wide spaces between bars
+static void grow_cells(const EnergyMap* map) {
+    memset(map->kind, CELL_NONE, (size_t)map->columns * map->rows);
+
+    for (int cy = 0; cy < map->rows; cy++) {
+        int top = cy > 0 ? cy - 1 : 0, bottom = cy + 1 < map->rows ? cy + 1 : cy;
+
+        for (int cx = 0; cx < map->columns; cx++) {
+            uint8_t kind = map->mask[(size_t)cy * map->columns + cx];
+            if (kind == CELL_NONE) continue;
+
+            int left = cx > 0 ? cx - 1 : 0, right = cx + 1 < map->columns ? cx + 1 : cx;
+
+            // horizontal cells win where both kinds grow
+            for (int y = top; y <= bottom; y++) {
+                uint8_t* cells = &map->kind[(size_t)y * map->columns];
+                for (int x = left; x <= right; x++) {
+                    if (cells[x] != CELL_HORIZONTAL) cells[x] = kind;
+                }
+            }
+        }
+    }
+}
+
+// inserts a region keeping the array sorted by decreasing energy
+static size_t insert_region(Region* regions, size_t count, size_t capacity, const Region* region) {
+    size_t i = count < capacity ? count : capacity;
+    if (i == capacity && (capacity == 0 || regions[capacity - 1].energy >= region->energy)) return count;
+
+    while (i > 0 && regions[i - 1].energy < region->energy) {
+        if (i < capacity) regions[i] = regions[i - 1];
+        i--;
+    }
+
+    regions[i] = *region;
+    return count < capacity ? count + 1 : capacity;
+}
+
+static size_t collect_regions(const Image* gray, int scale, EnergyMap* map, Region* regions, size_t capacity) {
+    size_t count = 0;
+    int columns = map->columns;
+
+    for (int start = 0; start < columns * map->rows; start++) {
+        uint8_t kind = map->kind[start];
+        if (kind == CELL_NONE) continue;
+
+        // flood fill of the component, cells are cleared once queued
+        int head = 0, tail = 0;
+        map->queue[tail++] = start;
+        map->kind[start] = CELL_NONE;
+
+        int left = columns, right = -1, top = map->rows, bottom = -1;
+        uint64_t energy = 0;
+
+        while (head < tail) {
+            int cell = map->queue[head++];
+            int cx = cell % columns, cy = cell / columns;
+
+            if (cx < left) left = cx;
+            if (cx > right) right = cx;
+            if (cy < top) top = cy;
+            if (cy > bottom) bottom = cy;
+            // dominance rather than raw energy, texture has a lot of both
+            uint32_t along = kind == CELL_HORIZONTAL ? map->dx[cell] : map->dy[cell];
+            uint32_t across = kind == CELL_HORIZONTAL ? map->dy[cell] : map->dx[cell];
+            if (along > across) energy += along - across;
+
+            int neighbors[4] = { cell - 1, cell + 1, cell - columns, cell + columns };
+            bool inside[4] = { cx > 0, cx + 1 < columns, cy > 0, cy + 1 < map->rows };
+
+            for (int i = 0; i < 4; i++) {
+                if (inside[i] && map->kind[neighbors[i]] == kind) {
+                    map->kind[neighbors[i]] = CELL_NONE;
+                    map->queue[tail++] = neighbors[i];
+                }
+            }
+        }
+
+        // too few cells, or shorter than the smallest barcode (one pixel per module)
+        int along = kind == CELL_HORIZONTAL ? right - left + 1 : bottom - top + 1;
+        if (tail < MIN_REGION_CELLS || along * scale < EAN8_MODULE_COUNT) continue;
+
+        left = left - REGION_MARGIN < 0 ? 0 : left - REGION_MARGIN;
+        top = top - REGION_MARGIN < 0 ? 0 : top - REGION_MARGIN;
+        right = right + REGION_MARGIN >= columns ? columns - 1 : right + REGION_MARGIN;
+        bottom = bottom + REGION_MARGIN >= map->rows ? map->rows - 1 : bottom + REGION_MARGIN;
+
+        Region region;
+        region.x = left * scale;
+        region.y = top * scale;
+        region.width = ((right + 1) * scale < gray->width ? (right + 1) * scale : gray->width) - region.x;
+        region.height = ((bottom + 1) * scale < gray->height ? (bottom + 1) * scale : gray->height) - region.y;
+        region.orientation = kind == CELL_HORIZONTAL ? ORIENTATION_HORIZONTAL : ORIENTATION_VERTICAL;
+        region.energy = energy / (uint64_t)tail;
+
+        count = insert_region(regions, count, capacity, &region);
+    }
+
+    return count;
+}
+
+static size_t locate_regions_map(const Image* gray, int scale, EnergyMap* map, Region* regions, size_t capacity) {
+    size_t n_cells = (size_t)map->columns * map->rows;
+
+    memset(map->dx, 0, n_cells * sizeof(uint32_t));
+    memset(map->dy, 0, n_cells * sizeof(uint32_t));
+
+    accumulate_energy(gray, scale, map);
+    classify_cells(map, scale);
+    filter_cells(map);
+    grow_cells(map);
+
+    return collect_regions(gray, scale, map, regions, capacity);
+}
+
+static bool is_valid_locate(const Image* gray, int scale, const Region* regions) {
+    return gray && gray->data && gray->channels == 1 && scale >= 2 && regions;
+}
+
+size_t locate_regions(const Image* gray, int scale, Region* regions, size_t capacity) {
+    if (!is_valid_locate(gray, scale, regions)) return 0;
+
+    EnergyMap map;
+    size_t n_cells = energy_map_cells(gray, scale, &map.columns, &map.rows);
+
+    map.dx = malloc(n_cells * sizeof(uint32_t));
+    map.dy = malloc(n_cells * sizeof(uint32_t));
+    map.kind = malloc(n_cells);
+    map.mask = malloc(n_cells);
+    map.queue = malloc(n_cells * sizeof(int));
+
+    size_t count = 0;
+    if (map.dx && map.dy && map.kind && map.mask && map.queue) {
+        count = locate_regions_map(gray, scale, &map, regions, capacity);
+    }
+
+    free(map.dx);
+    free(map.dy);
+    free(map.kind);
+    free(map.mask);
+    free(map.queue);
+
+    return count;
+}
+
+size_t locate_regions_ctx(LineVisionContext* context, const Image* gray, int scale, Region* regions, size_t capacity) {
+    if (!context || !is_valid_locate(gray, scale, regions)) return 0;
+
+    size_t mark = linevision_context_mark(context);
+
+    EnergyMap map;
+    size_t n_cells = energy_map_cells(gray, scale, &map.columns, &map.rows);
+
+    map.dx = linevision_context_alloc(context, n_cells * sizeof(uint32_t));
+    map.dy = linevision_context_alloc(context, n_cells * sizeof(uint32_t));
+    map.kind = linevision_context_alloc(context, n_cells);
+    map.mask = linevision_context_alloc(context, n_cells);
+    map.queue = linevision_context_alloc(context, n_cells * sizeof(int));
+
+    size_t count = 0;
+    if (map.dx && map.dy && map.kind && map.mask && map.queue) {
+        count = locate_regions_map(gray, scale, &map, regions, capacity);
+    }
+
+    rewind_linevision_context(context, mark);
+    return count;
+}
@@ -1,21 +1,139 @@
+#include <errno.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "batch.h"
+#include "detect.h"
 #include "image.h"
-#include "decode.h"
+#include "context.h"
 #include "ean_patterns.h"
+#include "scan.h"
 #include "ean_errors.h"
 
+// upper bound on the number of scanning threads
+#define MAX_WORKERS 8
+// upper bound on the batch threads requested with -j
+#define MAX_BATCH_WORKERS 64
+// barcodes reported by --all
+#define MAX_DETECTIONS 64
+// starting arena of each worker, the per-row scratch of a few thousand pixels wide image
+#define CONTEXT_CAPACITY (1 << 20)
+
+static void print_usage(const char* program) {
+    printf("Usage: %s <image_file>\n", program);
+    printf("       %s --batch [-j <workers>] <image_file|directory|->...\n", program);
+    printf("       %s --all <image_file>\n", program);
+}
+
+static size_t default_workers(void) {
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return n_cpus < 1 ? 1 : n_cpus > MAX_WORKERS ? MAX_WORKERS : (size_t)n_cpus;
+}
+
+static int main_batch(int argc, char* argv[]) {
+    size_t n_workers = default_workers();
+    int first = 2;
+
+    if (argc > 3 && strcmp(argv[2], "-j") == 0) {
+        char* end;
+        errno = 0;
+        long requested = strtol(argv[3], &end, 10);
+
+        if (end == argv[3] || *end != '\0' || errno == ERANGE || requested <= 0) {
+            fprintf(stderr, "Invalid number of workers: %s\n", argv[3]);
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        n_workers = requested > MAX_BATCH_WORKERS ? MAX_BATCH_WORKERS : (size_t)requested;
+        first = 4;
+    }
+
+    BatchPaths paths = { NULL, 0, 0 };
+    for (int i = first; i < argc; i++) {
+        if (add_batch_paths(&paths, argv[i]) != 0) {
+            fprintf(stderr, "Failed to read images from: %s\n", argv[i]);
+            clear_batch_paths(&paths);
+            return 1;
+        }
+    }
+
+    if (paths.count == 0) {
+        print_usage(argv[0]);
+        clear_batch_paths(&paths);
+        return 1;
+    }
+
+    int failures = run_batch(&paths, n_workers, stdout);
+    clear_batch_paths(&paths);
+
+    return failures == 0 ? 0 : 1;
+}
+
+static int main_all(const char* image_file) {
+    Image* image = open_image(image_file, 0);
+    if (!image) {
+        printf("Failed to load image file: %s\n", image_file);
+        return 1;
+    }
+
+    int threshold = rgb_to_grayscale_otsu(image, THRESHOLD_SAMPLING_STEP);
+
+    size_t n_workers = default_workers();
+
+    LineVisionContext* contexts[MAX_WORKERS];
+    for (size_t i = 0; i < n_workers; i++) {
+        contexts[i] = create_linevision_context(CONTEXT_CAPACITY);
+        if (!contexts[i]) {
+            printf("Failed to allocate the decoding context\n");
+            for (size_t j = 0; j < i; j++) destroy_linevision_context(contexts[j]);
+            close_image(image);
+            return 1;
+        }
+    }
+
+    // every barcode in one pass over the rows
+    Detection detections[MAX_DETECTIONS];
+    size_t count;
+    EAN8Error error = scan_all_ean8_parallel(contexts, n_workers, image, threshold, NULL, detections, MAX_DETECTIONS, &count);
+
+    for (size_t i = 0; i < n_workers; i++) destroy_linevision_context(contexts[i]);
+
+    for (size_t i = 0; i < count; i++) {
+        const Detection* detection = &detections[i];
+
+        printf("Barcode %zu: ", i + 1);
+        for (int k = 0; k < EAN8_DIGIT_COUNT; k++) printf("%d", detection->result.digits[k]);
+        printf(" x %d-%d y %d-%d (%zu rows)\n", detection->left, detection->right, detection->top, detection->bottom, detection->rows);
+    }
+
+    printf("Error result for decode: %s\n", ean8_error_to_string(error));
+
+    close_image(image);
+    return error == EAN8_ERROR_NONE ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        printf("Usage: %s <image_file>\n", argv[0]);
+        print_usage(argv[0]);
         return 1;
     }
 
+    if (strcmp(argv[1], "--batch") == 0) return main_batch(argc, argv);
+    if (strcmp(argv[1], "--all") == 0) {
+        if (argc < 3) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return main_all(argv[2]);
+    }
+
     char* image_file = argv[1];
 
-    Image* image = open_image(image_file, 1);
+    Image* image = open_image(image_file, 0);
     if (!image) {
         printf("Failed to load image file: %s\n", image_file);
         return 1;
@@ -24,37 +142,59 @@ int main(int argc, char* argv[]) {
     printf("Image loaded successfully!\n");
     print_image_info(image);
 
-    // binarization
-    int threshold = otsu_threshold(image->data, image->height * image->width);
-    printf("Threshold: %d\n", threshold);
-    binarization(image, threshold);
+    int threshold = rgb_to_grayscale_otsu(image, THRESHOLD_SAMPLING_STEP);
 
+    size_t n_workers = default_workers();
 
-    uint8_t* middle_segment = &image->data[image->width * (image->height / 2)];
-    size_t module = find_module(middle_segment, image->width);
-    printf("Module: %lu\n", module);
-
-    SegmentEAN* segment = create_segment_ean(middle_segment, image->width, module);
+    LineVisionContext* contexts[MAX_WORKERS];
+    for (size_t i = 0; i < n_workers; i++) {
+        contexts[i] = create_linevision_context(CONTEXT_CAPACITY);
+        if (!contexts[i]) {
+            printf("Failed to allocate the decoding context\n");
+            for (size_t j = 0; j < i; j++) destroy_linevision_context(contexts[j]);
+            close_image(image);
+            return 1;
+        }
+    }
 
-    print_segment_ean(segment);
-    printf("Segment start: %lu\n", segment->start);
-    printf("Segment middle: %lu\n", segment->middle);
-    printf("Segment end: %lu\n", segment->end);
+    ScanOptions options;
+    default_scan_options(&options);
 
     // decode CAB
-    EAN8Error error_decode;
-    int* cab = decode_ean8(segment, &error_decode);
+    EAN8Result cab;
+    DecodeReport report;
+    decode_image_ean8(contexts, n_workers, image, threshold, &options, &cab, &report);
+
+    // the adaptive stage thresholds every pixel against its own window
+    if (report.stage == DECODE_STAGE_ADAPTIVE) printf("Threshold: adaptive\n");
+    else printf("Threshold: %d\n", report.threshold);
+    if (report.orientation == ORIENTATION_VERTICAL) printf("Orientation: vertical\n");
 
-    for (int i = 0; i < 8; i++) {
-        printf("CAB[%d]: %d\n", i, cab[i]);
+    switch (report.stage) {
+        case DECODE_STAGE_PYRAMID: printf("Pyramid level: %d\n", report.level); break;
+        case DECODE_STAGE_REGION: printf("Region: %d candidates\n", (int)report.n_regions); break;
+        case DECODE_STAGE_ANGLE: printf("Angle: %d\n", report.angle); break;
+        default: break;
+    }
+
+    for (size_t i = 0; i < n_workers; i++) destroy_linevision_context(contexts[i]);
+
+    if (report.row >= 0) printf("Row: %d\n", report.row);
+    if (report.column >= 0) printf("Column: %d\n", report.column);
+
+    if (cab.status == EAN8_ERROR_NONE || cab.status == EAN8_ERROR_INVALID_CHECKSUM) {
+        for (int i = 0; i < 8; i++) {
+            printf("CAB[%d]: %d\n", i, cab.digits[i]);
+        }
+    }
+    if (cab.status == EAN8_ERROR_NONE) {
+        printf("Confidence: %d%s\n", cab.confidence, cab.recovered ? " (digit recovered from the check digit)" : "");
     }
 
-    printf("Error result for decode: %s\n", ean8_error_to_string(error_decode));
+    printf("Error result for decode: %s\n", ean8_error_to_string(cab.status));
 
     // free section
-    free(cab);
-    destroy_segment_ean(segment);
     close_image(image);
 
-    return 0;
+    return cab.status == EAN8_ERROR_NONE ? 0 : 1;
 }
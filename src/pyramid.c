@@ -0,0 +1,87 @@
+#include "pyramid.h"
+#include "image_kernels.h"
+#include <stdlib.h>
+
+// sets the sizes of the levels and returns the bytes needed by levels 1 and above
+static size_t pyramid_layout(ImagePyramid* pyramid, const Image* gray, int n_levels) {
+    size_t size = 0;
+
+    pyramid->levels[0] = *gray;
+    pyramid->n_levels = 1;
+    pyramid->data = NULL;
+
+    while (pyramid->n_levels < n_levels) {
+        const Image* previous = &pyramid->levels[pyramid->n_levels - 1];
+        if (previous->width < 2 || previous->height < 2) break;
+
+        Image* level = &pyramid->levels[pyramid->n_levels++];
+        level->width = previous->width / 2;
+        level->height = previous->height / 2;
+        level->channels = 1;
+        level->data = NULL;
+
+        size += (size_t)level->width * level->height;
+    }
+
+    return size;
+}
+
+static void build_pyramid(ImagePyramid* pyramid, unsigned char* data) {
+    pyramid->data = data;
+
+    for (int i = 1; i < pyramid->n_levels; i++) {
+        const Image* previous = &pyramid->levels[i - 1];
+        Image* level = &pyramid->levels[i];
+
+        level->data = data;
+        data += (size_t)level->width * level->height;
+
+        downsample_2x_u8(previous->data, previous->width, previous->width, previous->height, level->data, level->width);
+    }
+}
+
+static bool is_valid_pyramid_input(const Image* gray, int n_levels) {
+    return gray && gray->data && gray->channels == 1 && gray->width > 0 && gray->height > 0 &&
+           n_levels >= 1 && n_levels <= PYRAMID_MAX_LEVELS;
+}
+
+ImagePyramid* create_image_pyramid(const Image* gray, int n_levels) {
+    if (!is_valid_pyramid_input(gray, n_levels)) return NULL;
+
+    ImagePyramid* pyramid = malloc(sizeof(ImagePyramid));
+    if (!pyramid) return NULL;
+
+    size_t size = pyramid_layout(pyramid, gray, n_levels);
+    if (size == 0) return pyramid;
+
+    unsigned char* data = malloc(size);
+    if (!data) {
+        free(pyramid);
+        return NULL;
+    }
+
+    build_pyramid(pyramid, data);
+    return pyramid;
+}
+
+ImagePyramid* create_image_pyramid_ctx(LineVisionContext* context, const Image* gray, int n_levels) {
+    if (!is_valid_pyramid_input(gray, n_levels)) return NULL;
+
+    ImagePyramid* pyramid = linevision_context_alloc(context, sizeof(ImagePyramid));
+    if (!pyramid) return NULL;
+
+    size_t size = pyramid_layout(pyramid, gray, n_levels);
+    if (size == 0) return pyramid;
+
+    unsigned char* data = linevision_context_alloc(context, size);
+    if (!data) return NULL;
+
+    build_pyramid(pyramid, data);
+    return pyramid;
+}
+
+void destroy_image_pyramid(ImagePyramid* pyramid) {
+    if (!pyramid) return;
+    free(pyramid->data);
+    free(pyramid);
+}
@@ -0,0 +1,1064 @@
+#include "scan.h"
+#include "bitslice.h"
+#include "consensus.h"
+#include "line_walk.h"
+#include "pyramid.h"
+#include "decode.h"
+#include "image_kernels.h"
+#include "scanline.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// distinct checksum-valid results remembered while voting
+#define MAX_CANDIDATES 16
+// votes each digit needs before a per-digit consensus is accepted
+#define CONSENSUS_MIN_VOTES 2
+// barcodes of one scan whose failing rows are voted on separately
+#define MAX_CONSENSUS 4
+// module widths collected by estimate_module_fixed()
+#define MAX_MODULE_ESTIMATES 64
+// smallest module width a pyramid level is scanned at, 1.5 px
+#define PYRAMID_MIN_MODULE_FIXED (3u << (MODULE_FIXED_SHIFT - 1))
+// lines sampled to estimate the module width before picking a pyramid level
+#define PYRAMID_MODULE_SAMPLES 8
+// degrees between the scan angles tried when no row decodes
+#define SCAN_ANGLE_STEP 15
+// rows and columns whose transitions decide between a row and a column scan
+#define ORIENTATION_SAMPLES 8
+// pixels per side of the cells of the localization energy map
+#define LOCATE_SCALE 8
+// candidate regions scanned before falling back to the whole image
+#define MAX_REGIONS 4
+// images from this many pixels up are scanned through a pyramid
+#define PYRAMID_MIN_PIXELS 4000000
+
+typedef struct {
+    EAN8Result result;
+    size_t votes;
+    LinePosition line;
+} Candidate;
+
+// pixels of a row covered by a read, empty when unknown
+typedef struct {
+    int left;
+    int right;
+} ReadSpan;
+
+void default_scan_options(ScanOptions* options) {
+    if (!options) return;
+
+    options->order = SCAN_ORDER_CENTER_OUT;
+    options->row_step = 1;
+    options->max_rows = 0;
+    options->votes = 1;
+    options->engine = SCAN_ENGINE_ROWS;
+}
+
+int scan_schedule_row(const ScanOptions* options, int height, size_t index) {
+    if (!options || height <= 0) return -1;
+
+    size_t step = options->row_step == 0 ? 1 : options->row_step;
+
+    switch (options->order) {
+        case SCAN_ORDER_TOP_DOWN:
+            return index * step < (size_t)height ? (int)(index * step) : -1;
+        case SCAN_ORDER_BOTTOM_UP:
+            return index * step < (size_t)height ? height - 1 - (int)(index * step) : -1;
+        case SCAN_ORDER_CENTER_OUT:
+        default: {
+            size_t center = height / 2;
+            size_t distance = (index + 1) / 2 * step;
+            size_t below = height - 1 - center;
+
+            if (distance > center && distance > below) return -1;
+
+            // odd positions go up, even positions go down
+            if (index % 2 == 1) return distance <= center ? (int)(center - distance) : -2;
+            return distance <= below ? (int)(center + distance) : -2;
+        }
+    }
+}
+
+// how far a failed row got, used to report the most useful error
+static int error_rank(EAN8Error error) {
+    switch (error) {
+        case EAN8_ERROR_INVALID_CHECKSUM: return 3;
+        case EAN8_ERROR_INVALID_DECODE: return 2;
+        case EAN8_ERROR_INVALID_FORMAT: return 1;
+        default: return 0;
+    }
+}
+
+// keeps `attempt` in `result` when it succeeded or got further, returns whether it did
+static bool keep_best(EAN8Result* result, const EAN8Result* attempt) {
+    if (attempt->status != EAN8_ERROR_NONE && error_rank(attempt->status) <= error_rank(result->status)) return false;
+
+    *result = *attempt;
+    return true;
+}
+
+// decoding of an encoded row by run width ratios, then by module sampling;
+// on failure the read that got furthest is kept, with its partial digits
+// and the pixels it covers
+static EAN8Error decode_scanline_ean8(const Scanline* scanline, EAN8Result* result, ReadSpan* span) {
+    ReadSpan best = { 0, 0 };
+    size_t run;
+
+    // the window is only reported when one had valid guards
+    if (decode_scanline_edges_ean8(scanline, result, &run) != EAN8_ERROR_INVALID_FORMAT) {
+        const Run* last = &scanline->runs[run + EAN8_RUN_COUNT - 1];
+        best.left = (int)scanline->runs[run].start;
+        best.right = (int)(last->start + last->length);
+    }
+
+    // sub-pixel module from each window with consistent guards, sampled at module centers
+    EAN8Result sampled;
+    uint32_t fixed;
+    run = 0;
+    while (result->status != EAN8_ERROR_NONE && (fixed = find_module_fixed_scanline(scanline, run, &run)) != 0) {
+        EAN8Segment segment;
+        if (sample_segment_ean8_scanline(scanline, scanline->runs[run].start, fixed, &segment) == EAN8_ERROR_NONE) {
+            decode_segment_ean8(&segment, &sampled);
+            if (keep_best(result, &sampled)) {
+                best.left = (int)scanline->runs[run].start;
+                best.right = best.left + (int)(((uint64_t)fixed * EAN8_MODULE_COUNT) >> MODULE_FIXED_SHIFT);
+            }
+        }
+        run++;
+    }
+
+    if (result->status != EAN8_ERROR_NONE) {
+        size_t module = find_module_scanline(scanline);
+
+        EAN8Segment segment;
+        EAN8Result fallback;
+        // an empty span when no structure was found
+        size_t start = 0;
+        fixed = 0;
+        fallback.status = find_segment_ean8_scanline(scanline, module, &segment, &start, &fixed);
+        if (fallback.status == EAN8_ERROR_NONE) decode_segment_ean8(&segment, &fallback);
+
+        if (keep_best(result, &fallback)) {
+            best.left = (int)start;
+            best.right = best.left + (int)(((uint64_t)fixed * EAN8_MODULE_COUNT) >> MODULE_FIXED_SHIFT);
+        }
+    }
+
+    if (span) *span = best;
+    return result->status;
+}
+
+static EAN8Error decode_row_span_ean8(LineVisionContext* context, const uint8_t* row, size_t width, EAN8Result* result, ReadSpan* span) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!context || !row) return result->status;
+
+    size_t mark = linevision_context_mark(context);
+
+    Scanline* scanline = create_scanline_ctx(context, width);
+    if (!scanline || !build_scanline(scanline, row, width)) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+    } else {
+        decode_scanline_ean8(scanline, result, span);
+    }
+
+    rewind_linevision_context(context, mark);
+    return result->status;
+}
+
+EAN8Error decode_row_ean8(LineVisionContext* context, const uint8_t* row, size_t width, EAN8Result* result) {
+    return decode_row_span_ean8(context, row, width, result, NULL);
+}
+
+static EAN8Error decode_row_bits_span_ean8(LineVisionContext* context, const uint64_t* bits, size_t width, EAN8Result* result, ReadSpan* span) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!context || !bits) return result->status;
+
+    size_t mark = linevision_context_mark(context);
+
+    Scanline* scanline = create_scanline_ctx(context, width);
+    if (!scanline || !build_scanline_bits(scanline, bits, width)) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+    } else {
+        decode_scanline_ean8(scanline, result, span);
+    }
+
+    rewind_linevision_context(context, mark);
+    return result->status;
+}
+
+EAN8Error decode_row_bits_ean8(LineVisionContext* context, const uint64_t* bits, size_t width, EAN8Result* result) {
+    return decode_row_bits_span_ean8(context, bits, width, result, NULL);
+}
+
+static EAN8Error decode_row_gray_span_ean8(LineVisionContext* context, const uint8_t* row, size_t width, int threshold, EAN8Result* result, ReadSpan* span) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!context || !row) return result->status;
+
+    size_t mark = linevision_context_mark(context);
+
+    uint64_t* bits = linevision_context_alloc(context, packed_modules_words(width) * sizeof(uint64_t));
+    if (!bits) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+    } else {
+        // padding words read by the packed structure search
+        bits[(width + 63) / 64] = 0;
+        bits[(width + 63) / 64 + 1] = 0;
+
+        threshold_pack_u8(row, width, threshold, bits);
+        decode_row_bits_span_ean8(context, bits, width, result, span);
+    }
+
+    rewind_linevision_context(context, mark);
+    return result->status;
+}
+
+EAN8Error decode_row_gray_ean8(LineVisionContext* context, const uint8_t* row, size_t width, int threshold, EAN8Result* result) {
+    return decode_row_gray_span_ean8(context, row, width, threshold, result, NULL);
+}
+
+// records a checksum-valid result read on `weight` rows and returns its number of votes
+static size_t add_vote(Candidate* candidates, size_t* count, const EAN8Result* result, LinePosition line, size_t weight) {
+    for (size_t i = 0; i < *count; i++) {
+        if (memcmp(candidates[i].result.digits, result->digits, EAN8_DIGIT_COUNT) == 0) {
+            // a confirmed read replaces one whose digit came from the checksum
+            if (candidates[i].result.recovered && !result->recovered) {
+                candidates[i].result = *result;
+                candidates[i].line = line;
+            }
+            return candidates[i].votes += weight;
+        }
+    }
+
+    if (*count == MAX_CANDIDATES) return 0;
+
+    candidates[*count].result = *result;
+    candidates[*count].votes = weight;
+    candidates[*count].line = line;
+
+    return candidates[(*count)++].votes;
+}
+
+// digit votes of the failing reads of one barcode
+typedef struct {
+    DigitConsensus consensus;
+    /** walk angle, reads of different walks never mix */
+    int angle;
+    /** pixels along the line covered by the first read */
+    int left;
+    int right;
+    /** rows (or walk offsets) of the reads so far */
+    int top;
+    int bottom;
+} ConsensusSlot;
+
+// state shared by the workers of one scan
+typedef struct {
+    /** rows come from a binarized image, a bit plane, or a grayscale
+     *  image thresholded row by row when `lazy` is set */
+    const Image* image;
+    const BitPlane* plane;
+    bool lazy;
+    int threshold;
+    int width;
+    int height;
+    const ScanOptions* options;
+    size_t votes;
+    /** bit-sliced engine: the schedule hands out bands of rows */
+    bool bands;
+    ScanOptions band_options;
+    /** angled scan: the schedule hands out lines of each walk in turn,
+     *  sampled from the lazily thresholded grayscale image */
+    LineWalk** walks;
+    size_t n_walks;
+
+    /** next position of the schedule to hand out */
+    atomic_size_t next_index;
+    /** number of rows decoded so far, checked against the row budget */
+    atomic_size_t visited;
+    /** schedule position of the accepted result, SIZE_MAX while none */
+    atomic_size_t found_index;
+
+    pthread_mutex_t lock;
+    Candidate candidates[MAX_CANDIDATES];
+    size_t n_candidates;
+    /** digits of the rows read across each barcode, so that rows failing
+     *  on different digits of a damaged barcode add up to one result */
+    ConsensusSlot consensus[MAX_CONSENSUS];
+    size_t n_consensus;
+    size_t consensus_votes;
+    EAN8Result result;
+    LinePosition line;
+    EAN8Result failure;
+} SharedScan;
+
+typedef struct {
+    SharedScan* scan;
+    LineVisionContext* context;
+} ScanWorker;
+
+// consensus of the barcode a read belongs to: same walk, overlapping
+// pixels and a row at most half its width away, as in is_same_barcode();
+// NULL when the read has no span or every slot holds another barcode
+static DigitConsensus* find_consensus(SharedScan* scan, int angle, ReadSpan span, int across) {
+    if (span.right <= span.left) return NULL;
+
+    for (size_t i = 0; i < scan->n_consensus; i++) {
+        ConsensusSlot* slot = &scan->consensus[i];
+        if (slot->angle != angle || span.left >= slot->right || slot->left >= span.right) continue;
+
+        int gap = (slot->right - slot->left) / 2;
+        if (across < slot->top - gap || across > slot->bottom + gap) continue;
+
+        if (across < slot->top) slot->top = across;
+        if (across > slot->bottom) slot->bottom = across;
+        return &slot->consensus;
+    }
+
+    if (scan->n_consensus == MAX_CONSENSUS) return NULL;
+
+    ConsensusSlot* slot = &scan->consensus[scan->n_consensus++];
+    init_digit_consensus(&slot->consensus, scan->consensus_votes);
+    slot->angle = angle;
+    slot->left = span.left;
+    slot->right = span.right;
+    slot->top = across;
+    slot->bottom = across;
+
+    return &slot->consensus;
+}
+
+static void* scan_worker(void* arg) {
+    ScanWorker* worker = arg;
+    SharedScan* scan = worker->scan;
+    const ScanOptions* options = scan->options;
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&scan->next_index, 1);
+
+        // a row earlier in the schedule already succeeded: abandon the rest
+        if (index >= atomic_load(&scan->found_index)) break;
+
+        int y;
+        size_t n_rows = 1;
+        LineWalk* walk = NULL;
+        int x = scan->width / 2;
+        int offset = 0;
+        int shift = 0;
+
+        if (scan->walks) {
+            // every angle at one distance from the center before moving outwards
+            walk = scan->walks[index % scan->n_walks];
+            size_t k = index / scan->n_walks;
+            size_t step = options->row_step == 0 ? 1 : options->row_step;
+            size_t distance = (k + 1) / 2 * step;
+
+            if (distance > (size_t)(scan->width + scan->height) / 2) break;
+
+            offset = k % 2 == 1 ? -(int)distance : (int)distance;
+            if (!line_walk_center(walk, offset, &x, &y, &shift)) continue;
+        } else if (scan->bands) {
+            int n_bands = (scan->height + BITSLICE_ROWS - 1) / BITSLICE_ROWS;
+            int band = scan_schedule_row(&scan->band_options, n_bands, index);
+            if (band == -1) break;
+            if (band < 0) continue;
+
+            y = band * BITSLICE_ROWS;
+            n_rows = scan->height - y < BITSLICE_ROWS ? (size_t)(scan->height - y) : BITSLICE_ROWS;
+        } else {
+            y = scan_schedule_row(options, scan->height, index);
+            if (y == -1) break;
+            if (y < 0) continue;
+        }
+
+        if (options->max_rows != 0 && atomic_fetch_add(&scan->visited, n_rows) >= options->max_rows) break;
+
+        EAN8Result row_result;
+        EAN8Error error;
+        size_t weight = 1;
+        ReadSpan span = { 0, 0 };
+
+        if (walk) {
+            const Image* image = scan->image;
+            size_t mark = linevision_context_mark(worker->context);
+
+            uint8_t* line = linevision_context_alloc(worker->context, line_walk_capacity(walk));
+            if (!line) {
+                row_result.status = EAN8_ERROR_MEMORY_ALLOCATION;
+                error = row_result.status;
+            } else {
+                size_t center;
+                size_t length = sample_line_walk(walk, image->data, x, y, line, &center);
+                error = decode_row_gray_span_ean8(worker->context, line, length, scan->threshold, &row_result, &span);
+
+                // along the line from the perpendicular through the image center
+                span.left -= (int)center - shift;
+                span.right -= (int)center - shift;
+            }
+
+            rewind_linevision_context(worker->context, mark);
+        } else if (scan->bands) {
+            uint64_t match;
+            error = decode_band_ean8(worker->context, scan->plane, y, &row_result, &match);
+            if (error == EAN8_ERROR_NONE) {
+                weight = (size_t)__builtin_popcountll(match);
+                y += __builtin_ctzll(match);
+            }
+        } else if (scan->plane) {
+            const BitPlane* plane = scan->plane;
+            error = decode_row_bits_span_ean8(worker->context, bitplane_row(plane, y), plane->width, &row_result, &span);
+        } else if (scan->lazy) {
+            const Image* image = scan->image;
+            const uint8_t* row = &image->data[(size_t)y * image->width];
+            error = decode_row_gray_span_ean8(worker->context, row, image->width, scan->threshold, &row_result, &span);
+        } else {
+            const Image* image = scan->image;
+            const uint8_t* row = &image->data[(size_t)y * image->width];
+            error = decode_row_span_ean8(worker->context, row, image->width, &row_result, &span);
+        }
+
+        pthread_mutex_lock(&scan->lock);
+
+        LinePosition position = { x, y, walk ? walk->angle : 0 };
+        DigitConsensus* consensus = find_consensus(scan, position.angle, span, walk ? offset : y);
+        EAN8Result voted;
+
+        if (error == EAN8_ERROR_NONE) {
+            if (consensus) add_digit_votes(consensus, &row_result);
+            size_t votes = add_vote(scan->candidates, &scan->n_candidates, &row_result, position, weight);
+
+            // a recovered read is only a fallback: the checksum did not confirm it
+            if (votes >= scan->votes && !row_result.recovered && index < atomic_load(&scan->found_index)) {
+                scan->result = row_result;
+                scan->line = position;
+                atomic_store(&scan->found_index, index);
+            }
+        } else if (consensus && add_digit_votes(consensus, &row_result) &&
+                   digit_consensus_result(consensus, &voted) == EAN8_ERROR_NONE &&
+                   index < atomic_load(&scan->found_index)) {
+            // this row completed a per-digit majority of the rows of its barcode
+            scan->result = voted;
+            scan->line = position;
+            atomic_store(&scan->found_index, index);
+        } else if (error_rank(error) > error_rank(scan->failure.status) ||
+                   error == EAN8_ERROR_MEMORY_ALLOCATION) {
+            scan->failure = row_result;
+        }
+
+        bool out_of_memory = scan->failure.status == EAN8_ERROR_MEMORY_ALLOCATION;
+        pthread_mutex_unlock(&scan->lock);
+
+        if (out_of_memory) break;
+    }
+
+    return NULL;
+}
+
+static EAN8Error run_scan(SharedScan* scan, LineVisionContext** contexts, size_t n_workers, EAN8Result* result, int* prow, LinePosition* pline) {
+    for (size_t i = 0; i < n_workers; i++) {
+        if (!contexts[i]) return result->status;
+    }
+
+    ScanOptions defaults;
+    const ScanOptions* options = scan->options;
+    if (!options) {
+        default_scan_options(&defaults);
+        options = &defaults;
+    }
+
+    scan->options = options;
+    scan->votes = options->votes == 0 ? 1 : options->votes;
+
+    // bands are visited in the order of the rows, one band after the other
+    scan->bands = scan->plane && options->engine == SCAN_ENGINE_BITSLICED;
+    scan->band_options = *options;
+    scan->band_options.row_step = 1;
+    atomic_init(&scan->next_index, 0);
+    atomic_init(&scan->visited, 0);
+    atomic_init(&scan->found_index, SIZE_MAX);
+    scan->n_candidates = 0;
+    scan->n_consensus = 0;
+    scan->consensus_votes = scan->votes > CONSENSUS_MIN_VOTES ? scan->votes : CONSENSUS_MIN_VOTES;
+    scan->line.x = -1;
+    scan->line.y = -1;
+    scan->line.angle = 0;
+    scan->failure.status = EAN8_ERROR_INVALID_FORMAT;
+
+    if (pthread_mutex_init(&scan->lock, NULL) != 0) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+        return result->status;
+    }
+
+    ScanWorker workers[n_workers];
+    pthread_t threads[n_workers];
+    size_t started = 1;
+
+    for (size_t i = 0; i < n_workers; i++) {
+        workers[i].scan = scan;
+        workers[i].context = contexts[i];
+    }
+
+    // worker 0 runs on the calling thread
+    for (; started < n_workers; started++) {
+        if (pthread_create(&threads[started], NULL, scan_worker, &workers[started]) != 0) break;
+    }
+
+    scan_worker(&workers[0]);
+
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&scan->lock);
+
+    if (atomic_load(&scan->found_index) != SIZE_MAX) {
+        *result = scan->result;
+        if (prow) *prow = scan->line.y;
+        if (pline) *pline = scan->line;
+        return result->status;
+    }
+
+    if (scan->failure.status == EAN8_ERROR_MEMORY_ALLOCATION) {
+        result->status = scan->failure.status;
+        return result->status;
+    }
+
+    // budget spent: fall back on the most voted valid result, confirmed reads first
+    size_t best = scan->n_candidates;
+    for (size_t i = 0; i < scan->n_candidates; i++) {
+        const Candidate* candidate = &scan->candidates[i];
+        if (best == scan->n_candidates) {
+            best = i;
+            continue;
+        }
+
+        bool recovered = candidate->result.recovered, best_recovered = scan->candidates[best].result.recovered;
+        if (recovered != best_recovered ? !recovered : candidate->votes > scan->candidates[best].votes) best = i;
+    }
+
+    if (best < scan->n_candidates) {
+        *result = scan->candidates[best].result;
+        if (prow) *prow = scan->candidates[best].line.y;
+        if (pline) *pline = scan->candidates[best].line;
+        return result->status;
+    }
+
+    *result = scan->failure;
+    return result->status;
+}
+
+EAN8Error scan_image_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* image, const ScanOptions* options, EAN8Result* result, int* prow) {
+    if (prow) *prow = -1;
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !image || !image->data || image->channels != 1) return result->status;
+
+    SharedScan scan;
+    scan.image = image;
+    scan.plane = NULL;
+    scan.lazy = false;
+    scan.width = image->width;
+    scan.height = image->height;
+    scan.walks = NULL;
+    scan.options = options;
+
+    return run_scan(&scan, contexts, n_workers, result, prow, NULL);
+}
+
+EAN8Error scan_bitplane_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const BitPlane* plane, const ScanOptions* options, EAN8Result* result, int* prow) {
+    if (prow) *prow = -1;
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !plane || !plane->bits) return result->status;
+
+    SharedScan scan;
+    scan.image = NULL;
+    scan.plane = plane;
+    scan.lazy = false;
+    scan.width = plane->width;
+    scan.height = plane->height;
+    scan.walks = NULL;
+    scan.options = options;
+
+    return run_scan(&scan, contexts, n_workers, result, prow, NULL);
+}
+
+EAN8Error scan_gray_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* prow) {
+    if (prow) *prow = -1;
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1) return result->status;
+
+    SharedScan scan;
+    scan.image = gray;
+    scan.plane = NULL;
+    scan.lazy = true;
+    scan.threshold = threshold;
+    scan.width = gray->width;
+    scan.height = gray->height;
+    scan.walks = NULL;
+    scan.options = options;
+
+    return run_scan(&scan, contexts, n_workers, result, prow, NULL);
+}
+
+EAN8Error scan_image_ean8(LineVisionContext* context, const Image* image, const ScanOptions* options, EAN8Result* result, int* prow) {
+    return scan_image_ean8_parallel(&context, 1, image, options, result, prow);
+}
+
+EAN8Error scan_bitplane_ean8(LineVisionContext* context, const BitPlane* plane, const ScanOptions* options, EAN8Result* result, int* prow) {
+    return scan_bitplane_ean8_parallel(&context, 1, plane, options, result, prow);
+}
+
+EAN8Error scan_gray_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* prow) {
+    return scan_gray_ean8_parallel(&context, 1, gray, threshold, options, result, prow);
+}
+
+EAN8Error scan_binarized_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, const BinarizationOptions* binarization, const ScanOptions* options, EAN8Result* result, int* prow) {
+    if (prow) *prow = -1;
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1) return result->status;
+
+    BitPlane* plane = create_bitplane_ctx(contexts[0], gray->width, gray->height);
+    if (!plane) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+        return result->status;
+    }
+
+    if (!binarize_bitplane_with_options_ctx(contexts[0], gray, binarization, plane)) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+        return result->status;
+    }
+
+    return scan_bitplane_ean8_parallel(contexts, n_workers, plane, options, result, prow);
+}
+
+EAN8Error scan_binarized_ean8(LineVisionContext* context, const Image* gray, const BinarizationOptions* binarization, const ScanOptions* options, EAN8Result* result, int* prow) {
+    return scan_binarized_ean8_parallel(&context, 1, gray, binarization, options, result, prow);
+}
+
+EAN8Error scan_angles_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, int angle_step, EAN8Result* result, LinePosition* pline) {
+    if (pline) {
+        pline->x = -1;
+        pline->y = -1;
+        pline->angle = 0;
+    }
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1) return result->status;
+    if (angle_step <= 0 || angle_step > 90) return result->status;
+
+    // 0, +step, -step, +2 step... within (-90, 90]
+    size_t n_walks = 0;
+    LineWalk* walks[180];
+
+    for (int k = 0; k * angle_step <= 90; k++) {
+        int angles[2] = { k * angle_step, -k * angle_step };
+
+        for (int i = 0; i < (k == 0 ? 1 : 2); i++) {
+            if (angles[i] <= -90) continue;
+
+            walks[n_walks] = create_line_walk_ctx(contexts[0], gray->width, gray->height, angles[i]);
+            if (!walks[n_walks]) {
+                result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+                return result->status;
+            }
+            n_walks++;
+        }
+    }
+
+    SharedScan scan;
+    scan.image = gray;
+    scan.plane = NULL;
+    scan.lazy = true;
+    scan.threshold = threshold;
+    scan.width = gray->width;
+    scan.height = gray->height;
+    scan.walks = walks;
+    scan.n_walks = n_walks;
+    scan.options = options;
+
+    return run_scan(&scan, contexts, n_workers, result, NULL, pline);
+}
+
+EAN8Error scan_angles_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, int angle_step, EAN8Result* result, LinePosition* pline) {
+    return scan_angles_ean8_parallel(&context, 1, gray, threshold, options, angle_step, result, pline);
+}
+
+// columns of `gray` as the rows of an image living in the context, NULL on allocation failure
+static Image* transpose_image_ctx(LineVisionContext* context, const Image* gray) {
+    Image* transposed = linevision_context_alloc(context, sizeof(Image));
+    uint8_t* data = linevision_context_alloc(context, (size_t)gray->width * gray->height);
+    if (!transposed || !data) return NULL;
+
+    transposed->width = gray->height;
+    transposed->height = gray->width;
+    transposed->channels = 1;
+    transposed->data = data;
+
+    transpose_u8(gray->data, gray->width, gray->width, gray->height, data, gray->height);
+    return transposed;
+}
+
+EAN8Error scan_vertical_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* pcolumn) {
+    if (pcolumn) *pcolumn = -1;
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1) return result->status;
+
+    Image* transposed = transpose_image_ctx(contexts[0], gray);
+    if (!transposed) {
+        result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+        return result->status;
+    }
+
+    // the row decoders read a bottom-to-top barcode as well
+    return scan_gray_ean8_parallel(contexts, n_workers, transposed, threshold, options, result, pcolumn);
+}
+
+EAN8Error scan_vertical_ean8(LineVisionContext* context, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, int* pcolumn) {
+    return scan_vertical_ean8_parallel(&context, 1, gray, threshold, options, result, pcolumn);
+}
+
+// copies a region into `roi`, transposed for vertical regions so that it is always read along its rows
+static void copy_region(const Image* gray, const Region* region, Image* roi) {
+    const uint8_t* origin = &gray->data[(size_t)region->y * gray->width + region->x];
+
+    if (region->orientation == ORIENTATION_VERTICAL) {
+        roi->width = region->height;
+        roi->height = region->width;
+        transpose_u8(origin, gray->width, region->width, region->height, roi->data, region->height);
+        return;
+    }
+
+    roi->width = region->width;
+    roi->height = region->height;
+    for (int y = 0; y < region->height; y++) {
+        memcpy(&roi->data[(size_t)y * region->width], origin + (size_t)y * gray->width, region->width);
+    }
+}
+
+static bool is_valid_region(const Image* gray, const Region* region) {
+    return region->x >= 0 && region->y >= 0 && region->width > 0 && region->height > 0 &&
+           region->x + region->width <= gray->width && region->y + region->height <= gray->height;
+}
+
+EAN8Error scan_regions_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const Image* gray, const Region* regions, size_t n_regions, const ScanOptions* options, EAN8Result* result, LinePosition* pline) {
+    if (pline) {
+        pline->x = -1;
+        pline->y = -1;
+        pline->angle = 0;
+    }
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1 || (n_regions > 0 && !regions)) return result->status;
+
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+
+    for (size_t i = 0; i < n_regions; i++) {
+        const Region* region = &regions[i];
+        if (!is_valid_region(gray, region)) continue;
+
+        size_t mark = linevision_context_mark(contexts[0]);
+
+        Image roi;
+        roi.channels = 1;
+        roi.data = linevision_context_alloc(contexts[0], (size_t)region->width * region->height);
+        if (!roi.data) {
+            result->status = EAN8_ERROR_MEMORY_ALLOCATION;
+            return result->status;
+        }
+
+        copy_region(gray, region, &roi);
+
+        // threshold of the region alone, the background no longer drags it
+        int threshold = otsu_threshold(roi.data, roi.width * roi.height);
+
+        EAN8Result attempt;
+        int line;
+        LinePosition position;
+
+        scan_gray_ean8_parallel(contexts, n_workers, &roi, threshold, options, &attempt, &line);
+
+        if (region->orientation == ORIENTATION_VERTICAL) {
+            position.x = region->x + line;
+            position.y = region->y + region->height / 2;
+            position.angle = 90;
+        } else {
+            position.x = region->x + region->width / 2;
+            position.y = region->y + line;
+            position.angle = 0;
+        }
+
+        rewind_linevision_context(contexts[0], mark);
+
+        if (attempt.status == EAN8_ERROR_MEMORY_ALLOCATION) {
+            result->status = attempt.status;
+            return result->status;
+        }
+
+        if (attempt.status == EAN8_ERROR_NONE || error_rank(attempt.status) > error_rank(result->status)) {
+            *result = attempt;
+            if (pline && line >= 0) *pline = position;
+        }
+
+        if (result->status == EAN8_ERROR_NONE) break;
+    }
+
+    return result->status;
+}
+
+EAN8Error scan_regions_ean8(LineVisionContext* context, const Image* gray, const Region* regions, size_t n_regions, const ScanOptions* options, EAN8Result* result, LinePosition* pline) {
+    return scan_regions_ean8_parallel(&context, 1, gray, regions, n_regions, options, result, pline);
+}
+
+// module widths found along one line, appended to `modules`
+static size_t collect_modules(const Scanline* scanline, uint32_t* modules, size_t count) {
+    size_t run = 0;
+
+    while (count < MAX_MODULE_ESTIMATES) {
+        uint32_t module = find_module_fixed_scanline(scanline, run, &run);
+        if (module == 0) break;
+
+        modules[count++] = module;
+        run += 2;
+    }
+
+    return count;
+}
+
+uint32_t estimate_module_fixed(LineVisionContext* context, const Image* gray, int threshold, ImageOrientation orientation, int samples) {
+    if (!context || !gray || !gray->data || gray->channels != 1 || samples <= 0) return 0;
+
+    size_t mark = linevision_context_mark(context);
+
+    bool vertical = orientation == ORIENTATION_VERTICAL;
+    size_t length = vertical ? (size_t)gray->height : (size_t)gray->width;
+    size_t n_lines = vertical ? (size_t)gray->width : (size_t)gray->height;
+
+    uint8_t* line = linevision_context_alloc(context, length);
+    uint64_t* bits = linevision_context_alloc(context, ((length + 63) / 64) * sizeof(uint64_t));
+    Scanline* scanline = create_scanline_ctx(context, length);
+
+    uint32_t modules[MAX_MODULE_ESTIMATES];
+    size_t count = 0;
+
+    for (int i = 0; line && bits && scanline && i < samples; i++) {
+        size_t index = (i + 1) * n_lines / (samples + 1);
+        const uint8_t* pixels = line;
+
+        if (vertical) {
+            for (size_t y = 0; y < length; y++) line[y] = gray->data[y * gray->width + index];
+        } else {
+            pixels = &gray->data[index * gray->width];
+        }
+
+        threshold_pack_u8(pixels, length, threshold, bits);
+        if (!build_scanline_bits(scanline, bits, length)) break;
+
+        count = collect_modules(scanline, modules, count);
+    }
+
+    rewind_linevision_context(context, mark);
+
+    if (count == 0) return 0;
+
+    // median, robust to windows that only look like guards
+    for (size_t i = 1; i < count; i++) {
+        uint32_t module = modules[i];
+        size_t j = i;
+        for (; j > 0 && modules[j - 1] > module; j--) modules[j] = modules[j - 1];
+        modules[j] = module;
+    }
+
+    return modules[count / 2];
+}
+
+// midpoint of the means of the pixels on each side of the threshold
+static int center_threshold(const Image* gray, int threshold) {
+    int histogram[256] = { 0 };
+    histogram_u8(gray->data, (size_t)gray->width * gray->height, histogram);
+
+    uint64_t count[2] = { 0, 0 }, sum[2] = { 0, 0 };
+    for (int i = 0; i < 256; i++) {
+        int side = i > threshold;
+        count[side] += histogram[i];
+        sum[side] += (uint64_t)i * histogram[i];
+    }
+
+    if (count[0] == 0 || count[1] == 0) return threshold;
+
+    return (int)((sum[0] / count[0] + sum[1] / count[1]) / 2);
+}
+
+EAN8Error scan_pyramid_ean8_parallel(LineVisionContext** contexts, size_t n_workers, const ImagePyramid* pyramid, int threshold, ImageOrientation orientation, const ScanOptions* options, EAN8Result* result, int* pline, int* plevel) {
+    if (pline) *pline = -1;
+    if (plevel) *plevel = -1;
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !pyramid || pyramid->n_levels < 1 || pyramid->n_levels > PYRAMID_MAX_LEVELS) return result->status;
+
+    // box filtering turns edges into intermediate grays, which a threshold
+    // close to one of the two classes (e.g. at the start of an Otsu
+    // plateau) gives to that class; the coarsest level is cheap to count
+    threshold = center_threshold(&pyramid->levels[pyramid->n_levels - 1], threshold);
+
+    // coarsest level where modules are still 1.5 px wide, the coarsest of all when unknown
+    uint32_t module = estimate_module_fixed(contexts[0], &pyramid->levels[0], threshold, orientation, PYRAMID_MODULE_SAMPLES);
+
+    int start = pyramid->n_levels - 1;
+    if (module > 0) {
+        while (start > 0 && (module >> start) < PYRAMID_MIN_MODULE_FIXED) start--;
+    }
+
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+
+    for (int level = start; level >= 0; level--) {
+        const Image* image = &pyramid->levels[level];
+
+        EAN8Result attempt;
+        int line;
+
+        if (orientation == ORIENTATION_VERTICAL) {
+            size_t mark = linevision_context_mark(contexts[0]);
+            scan_vertical_ean8_parallel(contexts, n_workers, image, threshold, options, &attempt, &line);
+            rewind_linevision_context(contexts[0], mark);
+        } else {
+            scan_gray_ean8_parallel(contexts, n_workers, image, threshold, options, &attempt, &line);
+        }
+
+        if (attempt.status == EAN8_ERROR_MEMORY_ALLOCATION) {
+            result->status = attempt.status;
+            return result->status;
+        }
+
+        if (attempt.status == EAN8_ERROR_NONE || error_rank(attempt.status) > error_rank(result->status)) {
+            *result = attempt;
+            // center of the band of level 0 lines the level line was averaged from
+            if (pline) *pline = line >= 0 ? (line << level) + (1 << level) / 2 : -1;
+            if (plevel) *plevel = level;
+        }
+
+        if (result->status == EAN8_ERROR_NONE) break;
+    }
+
+    return result->status;
+}
+
+EAN8Error scan_pyramid_ean8(LineVisionContext* context, const ImagePyramid* pyramid, int threshold, ImageOrientation orientation, const ScanOptions* options, EAN8Result* result, int* pline, int* plevel) {
+    return scan_pyramid_ean8_parallel(&context, 1, pyramid, threshold, orientation, options, result, pline, plevel);
+}
+
+EAN8Error decode_image_ean8(LineVisionContext** contexts, size_t n_workers, const Image* gray, int threshold, const ScanOptions* options, EAN8Result* result, DecodeReport* report) {
+    if (!result) return EAN8_ERROR_INVALID_INPUT;
+
+    DecodeReport local;
+    if (!report) report = &local;
+
+    report->stage = DECODE_STAGE_NONE;
+    report->threshold = 0;
+    report->orientation = ORIENTATION_HORIZONTAL;
+    report->row = -1;
+    report->column = -1;
+    report->level = 0;
+    report->n_regions = 0;
+    report->angle = 0;
+
+    result->status = EAN8_ERROR_INVALID_INPUT;
+    if (!contexts || n_workers == 0 || !gray || !gray->data || gray->channels != 1) return result->status;
+
+    size_t mark = linevision_context_mark(contexts[0]);
+
+    // threshold from a subsampled histogram unless given, rows are binarized when visited
+    if (threshold < 0) threshold = otsu_threshold_subsampled(gray, THRESHOLD_SAMPLING_STEP);
+    ImageOrientation orientation = detect_orientation(gray, threshold, ORIENTATION_SAMPLES);
+    report->threshold = threshold;
+    report->orientation = orientation;
+
+    result->status = EAN8_ERROR_INVALID_FORMAT;
+
+    // most of a photo is not barcode, try the regions with barcode-like gradients first
+    Region regions[MAX_REGIONS];
+    size_t n_regions = locate_regions_ctx(contexts[0], gray, LOCATE_SCALE, regions, MAX_REGIONS);
+
+    EAN8Result located;
+    LinePosition position;
+    if (scan_regions_ean8_parallel(contexts, n_workers, gray, regions, n_regions, options, &located, &position) == EAN8_ERROR_NONE) {
+        report->stage = DECODE_STAGE_REGION;
+        report->n_regions = n_regions;
+        *result = located;
+        if (position.angle == 90) report->column = position.x;
+        else report->row = position.y;
+    } else if ((size_t)gray->width * gray->height >= PYRAMID_MIN_PIXELS) {
+        // large photos are decoded on the coarsest pyramid level their modules allow
+        ImagePyramid* pyramid = create_image_pyramid_ctx(contexts[0], gray, PYRAMID_MAX_LEVELS);
+
+        int line;
+        if (pyramid && scan_pyramid_ean8_parallel(contexts, n_workers, pyramid, threshold, orientation, options, result, &line, &report->level) == EAN8_ERROR_NONE) {
+            report->stage = DECODE_STAGE_PYRAMID;
+            if (orientation == ORIENTATION_VERTICAL) report->column = line;
+            else report->row = line;
+        }
+    } else {
+        // the whole image, which the finest pyramid level is for large photos
+        if (orientation == ORIENTATION_VERTICAL) {
+            scan_vertical_ean8_parallel(contexts, n_workers, gray, threshold, options, result, &report->column);
+        } else {
+            scan_gray_ean8_parallel(contexts, n_workers, gray, threshold, options, result, &report->row);
+        }
+        if (result->status == EAN8_ERROR_NONE) report->stage = DECODE_STAGE_IMAGE;
+    }
+
+    if (result->status != EAN8_ERROR_NONE) {
+        // uneven lighting defeats a global threshold, retry with a local one
+        BinarizationOptions binarization;
+        default_binarization_options(&binarization);
+        binarization.method = BINARIZATION_ADAPTIVE;
+
+        // vertical barcodes are read along the rows of the transposed image
+        bool vertical = orientation == ORIENTATION_VERTICAL;
+        const Image* source = vertical ? transpose_image_ctx(contexts[0], gray) : gray;
+
+        EAN8Result adaptive;
+        int line;
+        if (source && scan_binarized_ean8_parallel(contexts, n_workers, source, &binarization, options, &adaptive, &line) == EAN8_ERROR_NONE) {
+            report->stage = DECODE_STAGE_ADAPTIVE;
+            *result = adaptive;
+            report->row = vertical ? -1 : line;
+            report->column = vertical ? line : -1;
+        }
+    }
+
+    if (result->status != EAN8_ERROR_NONE) {
+        // tilted barcodes cross no row from guard to guard
+        EAN8Result angled;
+        LinePosition line;
+        if (scan_angles_ean8_parallel(contexts, n_workers, gray, threshold, options, SCAN_ANGLE_STEP, &angled, &line) == EAN8_ERROR_NONE) {
+            report->stage = DECODE_STAGE_ANGLE;
+            report->angle = line.angle;
+            *result = angled;
+            report->row = line.y;
+            report->column = -1;
+        }
+    }
+
+    rewind_linevision_context(contexts[0], mark);
+    return result->status;
+}
@@ -0,0 +1,147 @@
+#include "scanline.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+Scanline* create_scanline(size_t capacity) {
+    Scanline* scanline = malloc(sizeof(Scanline));
+    if (!scanline) return NULL;
+
+    if (capacity == 0) capacity = 64;
+
+    scanline->runs = malloc(capacity * sizeof(Run));
+    if (!scanline->runs) {
+        free(scanline);
+        return NULL;
+    }
+
+    scanline->count = 0;
+    scanline->capacity = capacity;
+    scanline->width = 0;
+    scanline->growable = true;
+
+    return scanline;
+}
+
+Scanline* create_scanline_ctx(LineVisionContext* context, size_t width) {
+    Scanline* scanline = linevision_context_alloc(context, sizeof(Scanline));
+    if (!scanline) return NULL;
+
+    size_t capacity = width == 0 ? 1 : width;
+
+    scanline->runs = linevision_context_alloc(context, capacity * sizeof(Run));
+    if (!scanline->runs) return NULL;
+
+    scanline->count = 0;
+    scanline->capacity = capacity;
+    scanline->width = 0;
+    scanline->growable = false;
+
+    return scanline;
+}
+
+void destroy_scanline(Scanline* scanline) {
+    if (!scanline) return;
+    free(scanline->runs);
+    free(scanline);
+}
+
+static bool push_run(Scanline* scanline, uint8_t color, size_t start, size_t length) {
+    if (scanline->count == scanline->capacity) {
+        if (!scanline->growable) return false;
+
+        size_t capacity = scanline->capacity * 2;
+        Run* runs = realloc(scanline->runs, capacity * sizeof(Run));
+        if (!runs) return false;
+
+        scanline->runs = runs;
+        scanline->capacity = capacity;
+    }
+
+    Run* run = &scanline->runs[scanline->count++];
+    run->color = color;
+    run->start = start;
+    run->length = length;
+
+    return true;
+}
+
+bool build_scanline(Scanline* scanline, const uint8_t* row, size_t length) {
+    if (!scanline || !row) return false;
+
+    scanline->count = 0;
+    scanline->width = length;
+    if (length == 0) return true;
+
+    // pixels are 0 for black, runs are 1 for bars
+    uint8_t current_color = row[0] == 0 ? 1 : 0;
+    size_t start = 0;
+
+    for (size_t i = 1; i < length; i++) {
+        uint8_t color = row[i] == 0 ? 1 : 0;
+        if (color != current_color) {
+            // Transition detected
+            if (!push_run(scanline, current_color, start, i - start)) return false;
+            current_color = color;
+            start = i;
+        }
+    }
+
+    return push_run(scanline, current_color, start, length - start);
+}
+
+bool build_scanline_bits(Scanline* scanline, const uint64_t* bits, size_t length) {
+    if (!scanline || !bits) return false;
+
+    scanline->count = 0;
+    scanline->width = length;
+    if (length == 0) return true;
+
+    uint8_t current_color = bits[0] & 1;
+    size_t start = 0;
+
+    size_t n_words = (length + 63) / 64;
+    uint64_t previous = current_color; // bit preceding pixel 0: no transition there
+
+    for (size_t w = 0; w < n_words; w++) {
+        uint64_t word = bits[w];
+
+        // bit i is set when pixel i differs from pixel i - 1
+        uint64_t edges = word ^ ((word << 1) | previous);
+        previous = word >> 63;
+
+        if (w == n_words - 1 && length % 64) edges &= (UINT64_C(1) << (length % 64)) - 1;
+
+        while (edges) {
+            size_t position = w * 64 + (size_t)__builtin_ctzll(edges);
+            if (!push_run(scanline, current_color, start, position - start)) return false;
+
+            current_color ^= 1;
+            start = position;
+            edges &= edges - 1;
+        }
+    }
+
+    return push_run(scanline, current_color, start, length - start);
+}
+
+size_t find_run_scanline(const Scanline* scanline, size_t pixel) {
+    size_t low = 0, high = scanline->count;
+
+    // first run ending past the pixel
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const Run* run = &scanline->runs[middle];
+
+        if (run->start + run->length <= pixel) low = middle + 1;
+        else high = middle;
+    }
+
+    return low;
+}
+
+void print_scanline(const Scanline* scanline) {
+    for (size_t i = 0; i < scanline->count; i++) {
+        printf("%ux%zu ", scanline->runs[i].color, scanline->runs[i].length);
+    }
+    printf("\n");
+}
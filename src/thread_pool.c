@@ -0,0 +1,235 @@
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct {
+    ThreadPoolTask function;
+    void* arg;
+} Task;
+
+// ring buffer: the owner works at the tail, thieves take from the head
+typedef struct {
+    Task* tasks;
+    size_t head;
+    size_t count;
+    size_t capacity;
+    pthread_mutex_t lock;
+} WorkQueue;
+
+typedef struct {
+    ThreadPool* pool;
+    size_t index;
+} Worker;
+
+struct ThreadPool {
+    size_t n_workers;
+    pthread_t* threads;
+    Worker* workers;
+    WorkQueue* queues;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    pthread_cond_t all_done;
+    /** tasks queued and not yet claimed by a worker */
+    size_t queued;
+    /** tasks submitted and not yet finished */
+    size_t pending;
+    /** queue receiving the next submitted task */
+    size_t next_queue;
+    bool stopping;
+};
+
+static bool push_task(WorkQueue* queue, Task task) {
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity == 0 ? 16 : queue->capacity * 2;
+        Task* tasks = malloc(capacity * sizeof(Task));
+        if (!tasks) {
+            pthread_mutex_unlock(&queue->lock);
+            return false;
+        }
+
+        for (size_t i = 0; i < queue->count; i++) {
+            tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+        }
+
+        free(queue->tasks);
+        queue->tasks = tasks;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+
+    queue->tasks[(queue->head + queue->count) % queue->capacity] = task;
+    queue->count++;
+
+    pthread_mutex_unlock(&queue->lock);
+    return true;
+}
+
+// newest task, taken by the owner
+static bool pop_task(WorkQueue* queue, Task* task) {
+    pthread_mutex_lock(&queue->lock);
+
+    bool found = queue->count > 0;
+    if (found) {
+        queue->count--;
+        *task = queue->tasks[(queue->head + queue->count) % queue->capacity];
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+// oldest task, taken by a thief
+static bool steal_task(WorkQueue* queue, Task* task) {
+    pthread_mutex_lock(&queue->lock);
+
+    bool found = queue->count > 0;
+    if (found) {
+        *task = queue->tasks[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static void* worker_main(void* arg) {
+    Worker* worker = arg;
+    ThreadPool* pool = worker->pool;
+
+    for (;;) {
+        // claim one of the queued tasks before looking for it
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        if (pool->queued == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+
+        Task task;
+        bool found = pop_task(&pool->queues[worker->index], &task);
+        for (size_t i = 1; !found; i++) {
+            found = steal_task(&pool->queues[(worker->index + i) % pool->n_workers], &task);
+        }
+
+        task.function(task.arg, worker->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_broadcast(&pool->all_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+ThreadPool* create_thread_pool(size_t n_workers) {
+    if (n_workers == 0) return NULL;
+
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+
+    pool->n_workers = n_workers;
+    pool->threads = malloc(n_workers * sizeof(pthread_t));
+    pool->workers = malloc(n_workers * sizeof(Worker));
+    pool->queues = calloc(n_workers, sizeof(WorkQueue));
+    if (!pool->threads || !pool->workers || !pool->queues) {
+        free(pool->threads);
+        free(pool->workers);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+
+    for (size_t i = 0; i < n_workers; i++) {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+    }
+
+    size_t started = 0;
+    for (; started < n_workers; started++) {
+        pool->workers[started].pool = pool;
+        pool->workers[started].index = started;
+        if (pthread_create(&pool->threads[started], NULL, worker_main, &pool->workers[started]) != 0) break;
+    }
+
+    if (started < n_workers) {
+        // stop the workers already running
+        pool->n_workers = started;
+        destroy_thread_pool(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+bool thread_pool_submit(ThreadPool* pool, ThreadPoolTask function, void* arg) {
+    if (!pool || !function) return false;
+
+    Task task = { function, arg };
+
+    pthread_mutex_lock(&pool->lock);
+    size_t queue = pool->next_queue;
+    pool->next_queue = (pool->next_queue + 1) % pool->n_workers;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!push_task(&pool->queues[queue], task)) return false;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pool->pending++;
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    return true;
+}
+
+void thread_pool_wait(ThreadPool* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+size_t thread_pool_workers(const ThreadPool* pool) {
+    return pool ? pool->n_workers : 0;
+}
+
+void destroy_thread_pool(ThreadPool* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->n_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < pool->n_workers; i++) {
+        free(pool->queues[i].tasks);
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    }
+
+    pthread_cond_destroy(&pool->all_done);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool->queues);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
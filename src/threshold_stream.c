@@ -0,0 +1,123 @@
+#include "threshold_stream.h"
+#include <stdlib.h>
+#include <string.h>
+
+ThresholdStream* create_threshold_stream(int width, int height, int step) {
+    if (width <= 0 || height <= 0 || step <= 0) return NULL;
+
+    ThresholdStream* stream = malloc(sizeof(ThresholdStream));
+    if (!stream) return NULL;
+
+    size_t columns = (size_t)(width + step - 1) / step;
+    size_t rows = (size_t)(height + step - 1) / step;
+
+    stream->count = columns * rows;
+    stream->samples = malloc(stream->count);
+    if (!stream->samples) {
+        free(stream);
+        return NULL;
+    }
+
+    stream->width = width;
+    stream->height = height;
+    stream->step = step;
+    stream->tolerance = 2;
+    stream->refresh = 20;
+
+    reset_threshold_stream(stream);
+
+    return stream;
+}
+
+void destroy_threshold_stream(ThresholdStream* stream) {
+    if (!stream) return;
+    free(stream->samples);
+    free(stream);
+}
+
+void reset_threshold_stream(ThresholdStream* stream) {
+    if (!stream) return;
+
+    memset(stream->histogram, 0, sizeof(stream->histogram));
+    stream->threshold = 0;
+    stream->changed = 0;
+    stream->primed = false;
+}
+
+// Otsu search in integers: with wB, wF the class counts and sumB, sumF the
+// class sums, wB * wF * (meanF - meanB)^2 = d^2 / (wB * wF) where
+// d = wB * sumF - wF * sumB, and the quotient always fits in 64 bits
+static int otsu_search_integer(const uint32_t histogram[256], size_t count) {
+    uint64_t sum_total = 0;
+    for (int i = 0; i < 256; i++) sum_total += (uint64_t)i * histogram[i];
+
+    uint64_t wB = 0, sumB = 0, best = 0;
+    int best_threshold = 0;
+
+    for (int i = 0; i < 256; i++) {
+        wB += histogram[i];
+        if (wB == 0) continue;
+
+        uint64_t wF = count - wB;
+        if (wF == 0) break;
+
+        sumB += (uint64_t)i * histogram[i];
+        uint64_t sumF = sum_total - sumB;
+
+        // meanF >= meanB, so d >= 0
+        unsigned __int128 d = (unsigned __int128)wB * sumF - (unsigned __int128)wF * sumB;
+        uint64_t var = (uint64_t)(d * d / ((unsigned __int128)wB * wF));
+
+        if (var > best) {
+            best = var;
+            best_threshold = i;
+        }
+    }
+
+    return best_threshold;
+}
+
+int threshold_stream_update(ThresholdStream* stream, const Image* frame) {
+    if (!stream || !frame || !frame->data || frame->channels != 1) return -1;
+    if (frame->width != stream->width || frame->height != stream->height) return -1;
+
+    uint8_t* sample = stream->samples;
+
+    if (!stream->primed) {
+        for (int y = 0; y < frame->height; y += stream->step) {
+            const uint8_t* row = &frame->data[(size_t)y * frame->width];
+            for (int x = 0; x < frame->width; x += stream->step) {
+                *sample++ = row[x];
+                stream->histogram[row[x]]++;
+            }
+        }
+
+        stream->primed = true;
+        stream->threshold = otsu_search_integer(stream->histogram, stream->count);
+        return stream->threshold;
+    }
+
+    size_t changed = 0;
+
+    for (int y = 0; y < frame->height; y += stream->step) {
+        const uint8_t* row = &frame->data[(size_t)y * frame->width];
+        for (int x = 0; x < frame->width; x += stream->step, sample++) {
+            int delta = (int)row[x] - *sample;
+            if (delta <= stream->tolerance && delta >= -stream->tolerance) continue;
+
+            stream->histogram[*sample]--;
+            stream->histogram[row[x]]++;
+            *sample = row[x];
+            changed++;
+        }
+    }
+
+    stream->changed += changed;
+
+    // the distribution has not shifted enough to move the threshold
+    if (stream->changed * 1000 <= stream->count * (size_t)stream->refresh) return stream->threshold;
+
+    stream->changed = 0;
+    stream->threshold = otsu_search_integer(stream->histogram, stream->count);
+    return stream->threshold;
+}